@@ -0,0 +1,93 @@
+// Throughput benchmark for the texel conversion kernels (see vpp/convert.hpp).
+// Runs every supported kind of conversion on a buffer that does not fit into the
+// caches and prints the throughput in texels and bytes (source + destination).
+// Usage: convertBench [texels] [iterations]
+
+#include <vpp/convert.hpp>
+#include <vpp/vulkan/enums.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+
+struct Kernel
+{
+	const char* name;
+	vk::Format src;
+	vk::Format dst;
+	unsigned int srcSize; //bytes per texel
+	unsigned int dstSize;
+};
+
+const Kernel kernels[] = {
+	{"copy rgba8", vk::Format::r8g8b8a8Unorm, vk::Format::r8g8b8a8Unorm, 4, 4},
+	{"expand rgb8 -> rgba8", vk::Format::r8g8b8Unorm, vk::Format::r8g8b8a8Unorm, 3, 4},
+	{"expand bgr8 -> rgba8", vk::Format::b8g8r8Unorm, vk::Format::r8g8b8a8Unorm, 3, 4},
+	{"swizzle rgba8 -> bgra8", vk::Format::r8g8b8a8Unorm, vk::Format::b8g8r8a8Unorm, 4, 4},
+	{"pack rgba16 -> rgba8", vk::Format::r16g16b16a16Unorm, vk::Format::r8g8b8a8Unorm, 8, 4},
+	{"pack rgba32f -> rgba8", vk::Format::r32g32b32a32Sfloat, vk::Format::r8g8b8a8Unorm, 16, 4},
+	{"pack rgba32f -> rgba16f", vk::Format::r32g32b32a32Sfloat,
+		vk::Format::r16g16b16a16Sfloat, 16, 8},
+	{"expand rgb32f -> rgba16f", vk::Format::r32g32b32Sfloat,
+		vk::Format::r16g16b16a16Sfloat, 12, 8},
+};
+
+} // anonymous util namespace
+
+int main(int argc, char** argv)
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::size_t count = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 4 * 1024 * 1024;
+	unsigned int iterations = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 20;
+	if(!count || !iterations)
+	{
+		std::fprintf(stderr, "usage: %s [texels] [iterations]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	//the float inputs are kept in [0, 1] so they are valid for all kernels
+	std::vector<float> srcData(count * 4);
+	for(auto i = 0u; i < srcData.size(); ++i) srcData[i] = (i % 1021) / 1020.f;
+
+	std::vector<std::uint8_t> dstData(count * 8);
+	std::printf("%u iterations of %zu texels\n", iterations, count);
+	std::printf("%-26s %10s %10s %10s\n", "kernel", "ms", "MTexel/s", "GB/s");
+
+	for(auto& kernel : kernels)
+	{
+		if(!vpp::texelConvertible(kernel.src, kernel.dst))
+		{
+			std::printf("%-26s not supported\n", kernel.name);
+			continue;
+		}
+
+		auto& src = *reinterpret_cast<const std::uint8_t*>(srcData.data());
+		vpp::convertTexels(src, kernel.src, dstData[0], kernel.dst, count); //warmup
+
+		//the fastest iteration is the least disturbed one
+		auto best = Clock::duration::max();
+		for(auto i = 0u; i < iterations; ++i)
+		{
+			auto start = Clock::now();
+			vpp::convertTexels(src, kernel.src, dstData[0], kernel.dst, count);
+			best = std::min(best, Clock::now() - start);
+		}
+
+		auto seconds = std::chrono::duration<double>(best).count();
+		auto bytes = double(count) * (kernel.srcSize + kernel.dstSize);
+		std::printf("%-26s %10.3f %10.1f %10.2f\n", kernel.name, seconds * 1000.0,
+			count / seconds / 1e6, bytes / seconds / 1e9);
+	}
+
+	//make sure the conversions are not optimized away
+	auto checksum = 0u;
+	for(auto i = 0u; i < dstData.size(); i += 4093) checksum += dstData[i];
+	std::printf("checksum %u\n", checksum);
+}
@@ -0,0 +1,197 @@
+// Soak test for the recycler used by the CommandPool.
+// Does not need a vulkan device: handles are plain numbers and fences are flags that
+// are signaled at random times (or by waiting "idle"). Several threads allocate, submit
+// and release handles through one recycler and check that a handle is never returned
+// while it is still used by another thread or its last submission is pending.
+
+#include <vpp/recycler.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr auto threadCount = 4u;
+constexpr auto iterations = 200000u;
+constexpr auto maxHandles = 1u << 20;
+constexpr auto kinds = 2u;
+
+std::atomic<std::uint64_t> idleCount {}; //how often the "device" was waited idle
+
+struct FenceState
+{
+	std::atomic<bool> signaled {};
+	std::uint64_t idleCount {}; //the fence is signaled after the next idle wait
+};
+
+struct Fence
+{
+	std::shared_ptr<FenceState> state;
+	explicit operator bool() const { return state != nullptr; }
+};
+
+bool signaled(const Fence& fence)
+{
+	return fence.state->signaled || fence.state->idleCount < idleCount;
+}
+
+using Recycler = vpp::Recycler<unsigned int, Fence>;
+
+Recycler recycler;
+std::atomic<unsigned int> nextHandle {1};
+std::atomic<unsigned int> discarded {};
+std::atomic<unsigned int> reused {};
+std::atomic<bool> failed {};
+
+//Whether a handle is owned by a thread. The fence of the last submission of every handle
+//is only accessed by the owning thread, the recycler synchronizes the ownership transfer.
+std::vector<std::atomic<bool>> owned(maxHandles);
+std::vector<Fence> lastSubmission(maxHandles);
+
+void fail(const char* msg, unsigned int handle)
+{
+	std::fprintf(stderr, "recyclerSoak: %s (handle %u)\n", msg, handle);
+	failed = true;
+}
+
+struct Live
+{
+	unsigned int handle;
+	unsigned int kind;
+};
+
+void run(unsigned int seed, bool discard)
+{
+	std::mt19937 rng(seed);
+	std::vector<Live> live;
+
+	auto discarder = [](unsigned int handle) {
+		if(lastSubmission[handle] && !signaled(lastSubmission[handle]))
+			fail("discarded pending handle", handle);
+		owned[handle] = false;
+		++discarded;
+	};
+
+	auto pop = [&]{
+		auto idx = rng() % live.size();
+		auto entry = live[idx];
+		live[idx] = live.back();
+		live.pop_back();
+		return entry;
+	};
+
+	for(auto i = 0u; i < iterations && !failed; ++i)
+	{
+		switch(rng() % 16)
+		{
+			case 0: case 1: case 2: case 3: case 4: case 5: //allocate and submit
+			{
+				unsigned int kind = rng() % kinds;
+				auto handle = recycler.take(kind, idleCount, signaled, discard, discarder);
+				if(handle)
+				{
+					++reused;
+					if(owned[handle].exchange(true)) fail("reused owned handle", handle);
+					if(lastSubmission[handle] && !signaled(lastSubmission[handle]))
+						fail("reused pending handle", handle);
+				}
+				else
+				{
+					handle = nextHandle++;
+					if(handle >= maxHandles) return;
+					owned[handle] = true;
+				}
+
+				auto state = std::make_shared<FenceState>();
+				state->idleCount = idleCount;
+				lastSubmission[handle] = {std::move(state)};
+				live.push_back({handle, kind});
+				break;
+			}
+			case 6: case 7: case 8: //complete the last submission of a live handle
+			{
+				if(live.empty()) break;
+				lastSubmission[live[rng() % live.size()].handle].state->signaled = true;
+				break;
+			}
+			case 9: case 10: case 11: //released with the fence, like CommandPool::recycle
+			{
+				if(live.empty()) break;
+				auto entry = pop();
+				auto fence = lastSubmission[entry.handle];
+				owned[entry.handle] = false;
+				recycler.release(entry.handle, entry.kind, std::move(fence));
+				break;
+			}
+			case 12: //released with an empty fence after it was completed
+			{
+				if(live.empty()) break;
+				auto entry = pop();
+				lastSubmission[entry.handle].state->signaled = true;
+				owned[entry.handle] = false;
+				recycler.release(entry.handle, entry.kind, {});
+				break;
+			}
+			case 13: case 14: //destructed without fence, may still be pending
+			{
+				if(live.empty()) break;
+				auto entry = pop();
+				owned[entry.handle] = false;
+				recycler.defer(entry.handle, entry.kind, idleCount);
+				break;
+			}
+			case 15: //wait idle, signals all fences submitted before
+			{
+				if(rng() % 8 == 0) ++idleCount;
+				break;
+			}
+		}
+	}
+
+	for(auto& entry : live)
+	{
+		owned[entry.handle] = false;
+		recycler.release(entry.handle, entry.kind, lastSubmission[entry.handle]);
+	}
+}
+
+} // anonymous util namespace
+
+int main()
+{
+	for(auto discard : {false, true})
+	{
+		std::vector<std::thread> threads;
+		for(auto i = 0u; i < threadCount; ++i)
+			threads.emplace_back(run, 1234u + i, discard);
+
+		for(auto& thread : threads) thread.join();
+	}
+
+	auto allocated = nextHandle - 1;
+	auto stored = recycler.size() + recycler.deferred();
+	if(stored + discarded != allocated)
+	{
+		std::fprintf(stderr, "recyclerSoak: lost handles (%u allocated, %u stored, %u discarded)\n",
+			allocated, unsigned(stored), discarded.load());
+		failed = true;
+	}
+
+	auto freed = 0u;
+	recycler.clear([&](unsigned int) { ++freed; });
+	if(freed != stored || recycler.size() || recycler.deferred())
+	{
+		std::fprintf(stderr, "recyclerSoak: clear did not free all handles\n");
+		failed = true;
+	}
+
+	std::printf("recyclerSoak: %u allocated, %u reused, %u discarded\n",
+		allocated, reused.load(), discarded.load());
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+// Checks that the pooled WorkBase operator new/delete does not allocate from the heap
+// once its thread local caches are warm. Replaces the global operator new and delete
+// to count the heap allocations. Does not need a vulkan device.
+
+#include <vpp/work.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+std::atomic<unsigned int> allocations {};
+std::atomic<unsigned int> deallocations {};
+bool failed {};
+
+///Work without gpu commands, padded to the given size class.
+template<std::size_t N>
+class PaddedWork : public vpp::FinishedWork<void>
+{
+public:
+	std::array<std::uint8_t, N> data {};
+};
+
+void check(bool cond, const char* what, unsigned int allocs)
+{
+	std::printf("%-52s %s (%u allocations)\n", what, cond ? "ok" : "FAILED", allocs);
+	if(!cond) failed = true;
+}
+
+///Returns the number of heap allocations done by the given function.
+template<typename F>
+unsigned int count(F&& func)
+{
+	auto before = allocations.load();
+	func();
+	return allocations.load() - before;
+}
+
+///Creates and destroys the given number of works of the given size, one after another.
+template<std::size_t N>
+void churn(unsigned int iterations)
+{
+	for(auto i = 0u; i < iterations; ++i)
+	{
+		std::unique_ptr<vpp::WorkBase> work = std::make_unique<PaddedWork<N>>();
+		work->finish();
+	}
+}
+
+///Creates the given number of works of the given size at once, then destroys them.
+template<std::size_t N, unsigned int Count>
+void batch()
+{
+	std::array<std::unique_ptr<vpp::WorkBase>, Count> works;
+	for(auto& work : works) work = std::make_unique<PaddedWork<N>>();
+}
+
+} // anonymous util namespace
+
+void* operator new(std::size_t size)
+{
+	++allocations;
+	if(auto ptr = std::malloc(size ? size : 1)) return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	if(ptr) ++deallocations;
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	operator delete(ptr);
+}
+
+int main()
+{
+	constexpr auto iterations = 10000u;
+
+	//the first work of every size class allocates a block
+	auto allocs = count([]{ churn<32>(1); churn<200>(1); churn<400>(1); });
+	check(allocs <= 3, "cold caches allocate once per size class", allocs);
+
+	allocs = count([]{ churn<32>(iterations); churn<200>(iterations); churn<400>(iterations); });
+	check(allocs == 0, "warm caches do not allocate", allocs);
+
+	//up to 64 blocks per size class and thread are cached
+	batch<100, 64>();
+	allocs = count([]{ for(auto i = 0u; i < 100; ++i) batch<100, 64>(); });
+	check(allocs == 0, "warm caches serve batches of 64 works", allocs);
+
+	allocs = count([]{ for(auto i = 0u; i < 100; ++i) batch<100, 80>(); });
+	check(allocs == 100 * 16, "larger batches only allocate the overflow", allocs);
+
+	//works larger than the largest size class always use the heap
+	allocs = count([]{ churn<1024>(iterations); });
+	check(allocs == iterations, "large works bypass the caches", allocs);
+
+	//works may be destroyed on other threads, the blocks are cached there
+	std::vector<std::unique_ptr<vpp::WorkBase>> works;
+	works.reserve(64);
+	for(auto i = 0u; i < 64; ++i) works.push_back(std::make_unique<PaddedWork<300>>());
+
+	std::thread([&]{
+		works.clear();
+		auto allocs = count([]{ churn<300>(iterations); });
+		check(allocs == 0, "blocks freed on another thread are reused there", allocs);
+	}).join();
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
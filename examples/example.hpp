@@ -137,13 +137,7 @@ LRESULT CALLBACK wndProc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)
 			if(gApp && gApp->initialized)
 			{
 				std::cout << "resizing to " << LOWORD(lparam) << "," << HIWORD(lparam) << "\n";
-				gApp->context.swapChain().resize({LOWORD(lparam), HIWORD(lparam)});
-
-				auto& swapChain = gApp->context.swapChain();
-				auto& info = gApp->rendererInfo;
-				gApp->renderer = {};
-				gApp->renderer = vpp::SwapChainRenderer(swapChain, info, gApp->func());
-
+				gApp->renderer.resize({LOWORD(lparam), HIWORD(lparam)});
 				gApp->renderer.renderBlock();
 				//render(*gApp);
 
@@ -115,7 +115,7 @@ public:
 
 protected:
 	ParticleSystem* system_;
-	vk::Semaphore computeSemaphore_;
+	vpp::PooledSemaphore computeSemaphore_;
 
 	std::vector<vk::PipelineStageFlags> waitMasks_;
 	std::vector<vk::CommandBuffer> buffers_;
@@ -127,7 +127,7 @@ protected:
 ParticleRenderer::ParticleRenderer(ParticleSystem& sys) : system_(&sys)
 {
 	auto& dev = ps().app_.context.device();
-	computeSemaphore_ = vk::createSemaphore(dev, {});
+	computeSemaphore_ = dev.semaphorePool().get();
 }
 
 ParticleRenderer::~ParticleRenderer()
@@ -203,7 +203,7 @@ ParticleRenderer::AdditionalSemaphores ParticleRenderer::submit(unsigned int id)
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &ps().computeBuffer_.vkHandle();
 	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = &computeSemaphore_;
+	submitInfo.pSignalSemaphores = &computeSemaphore_.vkHandle();
 
 	dev.submitManager().add(*ps().app_.context.graphicsComputeQueue(), submitInfo);
 
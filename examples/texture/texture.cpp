@@ -30,30 +30,19 @@ public:
 			extent.height = height;
 			extent.depth = 1;
 
-			auto info = vpp::ViewableImage::defaultColor2D();
-			info.imgInfo.extent = extent;
-			info.imgInfo.format = vk::Format::r8g8b8a8Unorm;
-			info.viewInfo.format = vk::Format::r8g8b8a8Unorm;
-			info.imgInfo.usage = vk::ImageUsageBits::sampled;
-
-			//either this
-			// info.imgInfo.tiling = vk::ImageTiling::linear;
-			// info.memoryFlags = vk::MemoryPropertyBits::hostVisible;
-
-			//or this
-			info.imgInfo.tiling = vk::ImageTiling::optimal;
-			info.imgInfo.usage |= vk::ImageUsageBits::transferDst;
-
+			//create a texture with a full mipmap chain which is generated on the device
+			auto info = vpp::ViewableImage::defaultTexture2D({extent.width, extent.height});
+			auto levels = info.imgInfo.mipLevels;
 			texture_ = {device(), info};
 
-			fill(texture_.image(), *data, vk::Format::r8g8b8a8Unorm, vk::ImageLayout::undefined,
-				extent, {vk::ImageAspectBits::color, 0, 0})->finish();
+			fillMipmapped(texture_.image(), *data, vk::Format::r8g8b8a8Unorm,
+				vk::ImageLayout::undefined, extent, levels)->finish();
 
 			//sampler
 			vk::SamplerCreateInfo samplerInfo;
 			samplerInfo.magFilter = vk::Filter::linear;
 			samplerInfo.minFilter = vk::Filter::linear;
-			samplerInfo.mipmapMode = vk::SamplerMipmapMode::nearest;
+			samplerInfo.mipmapMode = vk::SamplerMipmapMode::linear;
 			samplerInfo.addressModeU = vk::SamplerAddressMode::repeat;
 			samplerInfo.addressModeV = vk::SamplerAddressMode::repeat;
 			samplerInfo.addressModeW = vk::SamplerAddressMode::repeat;
@@ -63,7 +52,7 @@ public:
 			samplerInfo.compareEnable = false;
 			samplerInfo.compareOp = {};
 			samplerInfo.minLod = 0;
-			samplerInfo.maxLod = 0.25;
+			samplerInfo.maxLod = levels;
 			samplerInfo.borderColor = vk::BorderColor::floatTransparentBlack;
 			samplerInfo.unnormalizedCoordinates = false;
 			sampler_ = vk::createSampler(device(), samplerInfo);
@@ -92,7 +81,8 @@ public:
 
 			//write
 			vpp::DescriptorSetUpdate update(descriptorSet_);
-			update.imageSampler({{sampler_, texture_.vkImageView(), vk::ImageLayout::general}});
+			update.imageSampler({{sampler_, texture_.vkImageView(),
+				vk::ImageLayout::shaderReadOnlyOptimal}});
 		}
 
 		//pipeline
@@ -7,6 +7,17 @@ CommandWork<R>::CommandWork(CommandBuffer&& cmdBuf, vk::Queue queue) : cmdBuffer
 	state_ = WorkBase::State::pending;
 }
 
+template<typename R>
+CommandWork<R>::~CommandWork()
+{
+	//the command buffer might still be pending, so it is only reused once it completed
+	if(cmdBuffer_.vkHandle() && executionState_.valid() && !executionState_.completed())
+	{
+		executionState_.submit();
+		cmdBuffer_.commandPool().recycle(std::move(cmdBuffer_), executionState_.fence());
+	}
+}
+
 template<typename R>
 void CommandWork<R>::submit()
 {
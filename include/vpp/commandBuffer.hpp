@@ -17,24 +17,41 @@ namespace vpp
 class CommandPool;
 
 //RAII vulkan CommandBuffer wrapper.
+//Returns the command buffer to its pool on destruction. Since the pool cannot know whether
+//it is still pending execution, it is only reused after the device was waited idle
+//(see CommandPool::idle). Use CommandPool::recycle to return command buffers with the
+//fence of their last submission, they are reused as soon as it is signaled.
 class CommandBuffer : public ResourceHandleReference<vk::CommandBuffer, CommandBuffer>
 {
 public:
 	CommandBuffer() = default;
-	CommandBuffer(vk::CommandBuffer buffer, const CommandPool& pool);
+	CommandBuffer(vk::CommandBuffer buffer, const CommandPool& pool,
+		vk::CommandBufferLevel lvl = vk::CommandBufferLevel::primary);
 	~CommandBuffer();
 
-	CommandBuffer(CommandBuffer&& other) noexcept = default;
-	CommandBuffer& operator=(CommandBuffer&& other) noexcept = default;
+	CommandBuffer(CommandBuffer&& other) noexcept { swap(*this, other); }
+	CommandBuffer& operator=(CommandBuffer other) noexcept { swap(*this, other); return *this; }
 
 	const CommandPool& commandPool() const { return *commandPool_; }
 	const CommandPool& resourceRef() const { return *commandPool_; }
+	vk::CommandBufferLevel level() const { return level_; }
+
+	friend void swap(CommandBuffer& a, CommandBuffer& b) noexcept;
 
 protected:
+	friend class CommandPool;
+
 	const CommandPool* commandPool_ {};
+	vk::CommandBufferLevel level_ {vk::CommandBufferLevel::primary};
 };
 
 //RAII vulkan CommandPool wrapper.
+//Command buffers returned to the pool are reused by allocate once they are no longer
+//pending execution, i.e. when the fence they were recycled with is signaled or, for
+//command buffers that were simply destructed, after the device was waited idle.
+//If the pool was created with the resetCommandBuffer flag, they are reset individually,
+//otherwise they are freed and new ones allocated.
+//Command buffers allocated from a pool must not outlive it.
 class CommandPool : public ResourceHandle<vk::CommandPool>
 {
 public:
@@ -42,21 +59,54 @@ public:
 	CommandPool(const Device& dev, std::uint32_t qfam, vk::CommandPoolCreateFlags flags = {});
 	~CommandPool();
 
-	CommandPool(CommandPool&& other) noexcept = default;
-	CommandPool& operator=(CommandPool&& other) noexcept = default;
+	CommandPool(CommandPool&& other) noexcept;
+	CommandPool& operator=(CommandPool&& other) noexcept;
 
 	CommandBuffer allocate(vk::CommandBufferLevel lvl = vk::CommandBufferLevel::primary);
 	std::vector<CommandBuffer> allocate(std::size_t count,
 		vk::CommandBufferLevel lvl = vk::CommandBufferLevel::primary);
 
+	///Resets the pool, no command buffer allocated from it may be pending.
+	///Makes all destructed command buffers reusable (see idle).
 	void reset(vk::CommandPoolResetFlags flags) const;
 
+	///Returns the given command buffer (which must be allocated from this pool) to the pool.
+	///It will only be reused once the given fence is signaled, i.e. it may still be pending
+	///execution. If the fence is empty, the command buffer must not be pending anymore
+	///and is reused directly. Can be called from any thread.
+	void recycle(CommandBuffer&& buffer, const FenceRef& fence) const;
+
+	///Signals the pool that none of its command buffers is pending execution anymore.
+	///Makes the command buffers that were destructed without fence reusable.
+	///This happens automatically after the device was waited idle (see Device::waitIdle)
+	///since they were destructed. Can be called from any thread.
+	void idle() const;
+
+	///Frees all command buffers returned to this pool without checking whether they
+	///are still pending execution.
+	void freeRecycled();
+
+	///Returns the number of command buffers that were allocated from the vulkan pool and
+	///the number of times a recycled one was reused instead.
+	std::size_t allocated() const { return allocated_; }
+	std::size_t reused() const { return reused_; }
+
 	const std::uint32_t& queueFamily() const { return qFamily_; }
 	const vk::CommandPoolCreateFlags& flags() const { return flags_; }
 
+protected:
+	struct Recycler;
+	friend class CommandBuffer;
+
+	void release(vk::CommandBuffer buffer, vk::CommandBufferLevel lvl, const FenceRef* fence) const;
+	vk::CommandBuffer reuse(vk::CommandBufferLevel lvl);
+
 protected:
 	vk::CommandPoolCreateFlags flags_ {};
 	std::uint32_t qFamily_ {};
+	std::unique_ptr<Recycler> recycler_; //returned command buffers, synchronized
+	std::size_t allocated_ {};
+	std::size_t reused_ {};
 };
 
 //Able to efficiently provide commandBuffer of all types for all threads by holding an internal
@@ -68,6 +118,8 @@ public:
 	~CommandProvider() = default;
 
 	///Allocates a commandBuffer for the calling thread that matches the given requirements.
+	///The pools of the provider are always created with the resetCommandBuffer flag, so
+	///command buffers that were returned to them are reused.
 	CommandBuffer get(std::uint32_t qfamily, vk::CommandPoolCreateFlags flags = {},
 		vk::CommandBufferLevel lvl = vk::CommandBufferLevel::primary);
 
@@ -32,6 +32,8 @@ namespace vpp
 ///A Vulkan Context. Can be used to easily create Device and Swapchain.
 ///The Context will automatically create a present queue for its surface as well as a graphics
 ///and compute queue (if possible just one queue for all needs).
+///A headless context (see createHeadlessContext) has no surface and swapChain and only
+///creates the graphics and compute queue, which is then also returned as present queue.
 ///If more fine-grained control over device, queues and swapChain creation is needed, consider
 ///creating them manually.
 class Context
@@ -45,6 +47,10 @@ public:
 		vk::DebugReportFlagsEXT debugFlags = contextDefaultDebugFlags;
 		std::vector<const char*> instanceExtensions;
 		std::vector<const char*> deviceExtensions;
+
+		///If true, the instance is created without the surface extension. Used for headless
+		///contexts, no surface and swapChain can be initialized then.
+		bool headless = false;
 	};
 
 public:
@@ -57,6 +63,9 @@ public:
 
 	const Surface& surface() const { return surface_; }
 
+	///Returns whether the context has no surface, i.e. can only be used for offscreen rendering.
+	bool headless() const { return !surface_.vkSurface(); }
+
 	const Device& device() const { return *device_; }
 	const SwapChain& swapChain() const { return swapChain_; }
 
@@ -91,4 +100,9 @@ protected:
 	std::unique_ptr<DebugCallback> debugCallback_;
 };
 
+///Creates a vulkan context without any surface or swapChain, e.g. for rendering on servers
+///or in benchmarks without a window system. Only a graphics and compute queue is created.
+///\sa OffscreenRenderer
+Context createHeadlessContext(Context::CreateInfo info = {});
+
 }
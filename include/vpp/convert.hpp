@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vpp/fwd.hpp>
+#include <vpp/vulkan/enums.hpp>
+
+#include <cstdint>
+#include <cstddef>
+
+namespace vpp
+{
+
+///Returns whether texels of the given source format can be converted into the given
+///destination format using convertTexels.
+///Supported are all conversions between formats with the same memory layout (copy) and
+///the following conversions, where only the channel layout and not the numeric format
+///(e.g. unorm/srgb/uint) of 8 bit formats matters:
+/// - rgb8/bgr8 to rgba8/bgra8 (expand with alpha set to the maximum)
+/// - rgba8 to bgra8 and vice versa (swizzle)
+/// - rgba16 (unorm) to rgba8 (unorm)
+/// - rgba32 and rgb32 (sfloat) to rgba16 (sfloat)
+/// - rgba32 (sfloat) to rgba8 (unorm)
+///No color space conversion is done, i.e. the data of an srgb format is treated like unorm data.
+bool texelConvertible(vk::Format src, vk::Format dst);
+
+///Converts the given number of texels from the source to the destination format.
+///Uses SIMD (SSE2/SSSE3/AVX2/F16C or NEON, depending on the target the library was
+///compiled for) kernels with a scalar fallback.
+///Source and destination must not overlap. Does not require any alignment.
+///\exception std::logic_error if the formats are not convertible. \sa texelConvertible
+void convertTexels(const std::uint8_t& src, vk::Format srcFormat, std::uint8_t& dst,
+	vk::Format dstFormat, std::size_t count);
+
+}
@@ -5,6 +5,7 @@
 
 #include <memory>
 #include <vector>
+#include <deque>
 
 namespace vpp
 {
@@ -49,6 +50,11 @@ public:
 	///Waits until all operations on this device are finished.
 	void waitIdle() const;
 
+	///Returns how often waitIdle was called. Resources that were released without knowing
+	///whether they are still in use (e.g. destructed command buffers) can be reused once
+	///this count increased since their release.
+	std::uint64_t idleCount() const;
+
 	///Returns all available queues for the created device.
 	///Note that if the Device was created from an external device (and therefore given
 	///information about the queues) this function call will only return the queues given to
@@ -94,6 +100,25 @@ public:
 	///\sa SubmitManager
 	SubmitManager& submitManager() const;
 
+	///Returns the fence pool for this device.
+	///\sa FencePool
+	FencePool& fencePool() const;
+
+	///Returns the semaphore pool for this device.
+	///\sa SemaphorePool
+	SemaphorePool& semaphorePool() const;
+
+	///Returns the completion monitor that runs the callbacks registered for submissions
+	///of this device once they completed.
+	///\sa CompletionMonitor
+	CompletionMonitor& completionMonitor() const;
+
+	///Runs all completion callbacks (e.g. registered with Work::then) whose submissions have
+	///completed. Can be called once per frame if the completion monitor thread is not used.
+	///Returns the number of completed callbacks.
+	///\sa CompletionMonitor::poll
+	std::size_t pollCompletions() const;
+
 	///Return the default transferManager for this device.
 	///\sa TransferManager
 	TransferManager& transferManager() const;
@@ -127,7 +152,7 @@ protected:
 	friend class CommandProvider; //must acces threadLocalPools
 
 protected:
-	std::vector<CommandPool>& tlCommandPools() const;
+	std::deque<CommandPool>& tlCommandPools() const; //deque since buffers reference their pool
 	TLStorage& tlStorage() const;
 	void release();
 
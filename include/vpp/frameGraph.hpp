@@ -0,0 +1,261 @@
+#pragma once
+
+#include <vpp/fwd.hpp>
+#include <vpp/resource.hpp>
+#include <vpp/renderPass.hpp>
+#include <vpp/framebuffer.hpp>
+#include <vpp/commandBuffer.hpp>
+#include <vpp/sync.hpp>
+#include <vpp/vulkan/structs.hpp>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vpp
+{
+
+///Id of an image or buffer in a FrameGraph.
+using FrameResource = unsigned int;
+
+///One pass of a FrameGraph.
+///Declares which resources it uses in which way and records its commands with the given
+///record function. Passes that have color or depth stencil attachments are render passes,
+///the FrameGraph creates a RenderPass and Framebuffer for them and calls the record function
+///inside a render pass instance.
+///The functions declaring uses return a reference to the pass to allow chaining them.
+class FramePass
+{
+public:
+	///Records the commands of the pass into the given command buffer.
+	///If the FrameGraph records in parallel, it is called from a worker thread and the
+	///command buffer is a secondary command buffer (inheriting the render pass if there is one).
+	using RecordFunc = std::function<void(vk::CommandBuffer, const FramePass&)>;
+
+public:
+	///Uses the given image as color attachment.
+	///If loadOp is load, the previous contents are read.
+	FramePass& color(FrameResource image,
+		vk::AttachmentLoadOp loadOp = vk::AttachmentLoadOp::dontCare,
+		const vk::ClearColorValue& clear = {});
+
+	///Uses the given image as depth stencil attachment.
+	///If loadOp is load, the previous contents are read.
+	FramePass& depthStencil(FrameResource image,
+		vk::AttachmentLoadOp loadOp = vk::AttachmentLoadOp::dontCare,
+		const vk::ClearDepthStencilValue& clear = {1.f, 0});
+
+	///Reads the given image in a shader, e.g. as sampled image.
+	FramePass& sampled(FrameResource image,
+		vk::PipelineStageFlags stages = vk::PipelineStageBits::fragmentShader);
+
+	///Uses the given image as storage image in the general layout.
+	FramePass& storage(FrameResource image, bool write,
+		vk::PipelineStageFlags stages = vk::PipelineStageBits::computeShader);
+
+	///Uses the given image as source or destination of transfer commands.
+	FramePass& transferSrc(FrameResource image);
+	FramePass& transferDst(FrameResource image);
+
+	///Uses the given buffer with the given accesses. If the stages are empty, they are
+	///derived from the accesses (see accessStages).
+	FramePass& read(FrameResource buffer, vk::AccessFlags access,
+		vk::PipelineStageFlags stages = {});
+	FramePass& write(FrameResource buffer, vk::AccessFlags access,
+		vk::PipelineStageFlags stages = {});
+
+	///Marks the pass as having side effects outside of the graph, it will never be culled.
+	FramePass& sideEffects();
+
+	///Sets the function that records the commands of this pass.
+	FramePass& record(RecordFunc func);
+
+	const std::string& name() const { return name_; }
+
+	///Returns whether the pass has attachments and is therefore recorded in a render pass.
+	bool renderPass() const { return !attachments_.empty(); }
+
+	///Returns whether the pass was culled in the last compile since none of its results
+	///are needed.
+	bool culled() const { return culled_; }
+
+	///The render pass, framebuffer and size of the framebuffer of a render pass.
+	///Only valid after the graph was compiled.
+	vk::RenderPass vkRenderPass() const { return renderPass_; }
+	vk::Framebuffer vkFramebuffer() const { return framebuffer_; }
+	const vk::Extent2D& extent() const { return extent_; }
+
+protected:
+	friend class FrameGraph;
+
+	struct Use
+	{
+		FrameResource resource;
+		vk::ImageLayout layout; //undefined for buffers
+		vk::AccessFlags access;
+		vk::PipelineStageFlags stages;
+	};
+
+	struct Attachment
+	{
+		FrameResource resource;
+		vk::AttachmentLoadOp loadOp;
+		vk::ClearValue clear;
+		bool depth;
+	};
+
+	FramePass(std::string name) : name_(std::move(name)) {}
+	FramePass& use(FrameResource res, vk::ImageLayout layout, vk::AccessFlags access,
+		vk::PipelineStageFlags stages);
+
+protected:
+	std::string name_;
+	std::vector<Use> uses_;
+	std::vector<Attachment> attachments_;
+	RecordFunc record_;
+	bool sideEffects_ {};
+	bool culled_ {};
+
+	RenderPass renderPass_;
+	Framebuffer framebuffer_;
+	vk::Extent2D extent_ {};
+	CommandBuffer commandBuffer_; //secondary command buffer for parallel recording
+};
+
+///Declarative description of the passes of a frame and the resources they use.
+///Passes are declared in a logical order: a pass reading a resource reads what the last
+///pass declared before it wrote. When compiled, the graph culls all passes whose results
+///are not needed for an output (imported resources or passes with side effects), orders
+///the remaining passes, creates render passes and framebuffers and creates the transient
+///images with aliased memory, i.e. images whose lifetimes do not overlap share memory.
+///When recorded, all barriers and layout transitions are derived from the declared uses
+///(see ResourceStateTracker) and recorded batched before each pass.
+///The passes can be recorded in parallel into secondary command buffers by worker threads.
+///Resources and passes can only be added before the graph is compiled.
+///Must be synchronized externally and a compiled graph must not be recorded into
+///multiple command buffers that are pending at the same time.
+class FrameGraph : public Resource
+{
+public:
+	struct ImageInfo
+	{
+		vk::Format format {};
+		vk::Extent2D extent {};
+		vk::ImageAspectFlags aspects {vk::ImageAspectBits::color};
+		vk::SampleCountBits samples {vk::SampleCountBits::e1};
+		vk::ImageUsageFlags usage {}; //additional usage, the declared uses are added
+	};
+
+	///Statistics of the last compile.
+	struct Stats
+	{
+		unsigned int passes {}; //not culled passes
+		unsigned int culled {};
+		vk::DeviceSize transientSize {}; //summed memory size of all transient images
+		vk::DeviceSize allocatedSize {}; //allocated memory with aliasing
+	};
+
+public:
+	///\param queueFamily The family of the queue the recorded commands will be submitted to.
+	///\param recordThreads The number of worker threads recording the passes in parallel.
+	///If zero, all passes are recorded directly into the given command buffer.
+	FrameGraph(const Device& dev, unsigned int queueFamily, unsigned int recordThreads = 0);
+	~FrameGraph();
+
+	FrameGraph(FrameGraph&&) = delete;
+	FrameGraph& operator=(FrameGraph&&) = delete;
+
+	///Adds a transient image that is created by the graph and only valid during the frame.
+	FrameResource image(const ImageInfo& info);
+
+	///Imports an external image (e.g. a swap chain image) into the graph.
+	///Imported images are outputs, i.e. the passes writing them are never culled.
+	///The first use of the image waits for all previous commands on the queue.
+	///\param initialLayout The layout the image has when the commands are executed.
+	///\param finalLayout The layout the image will be changed to at the end of the frame.
+	///If undefined, the layout of its last use is kept.
+	FrameResource importImage(vk::Image image, vk::ImageView view, const ImageInfo& info,
+		vk::ImageLayout initialLayout = vk::ImageLayout::undefined,
+		vk::ImageLayout finalLayout = vk::ImageLayout::undefined);
+
+	///Imports an external buffer range into the graph. See importImage.
+	FrameResource importBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0,
+		vk::DeviceSize size = vk::wholeSize);
+
+	///Changes the image and view of an imported image, e.g. to the next swap chain image.
+	///Recreates the framebuffers using the image the next time the graph is recorded.
+	///The image must be compatible with the one it was imported with.
+	void reimport(FrameResource image, vk::Image vkImage, vk::ImageView view);
+
+	///Adds a new pass to the end of the graph. The returned reference stays valid.
+	FramePass& pass(std::string name);
+
+	///Culls and orders the passes and creates all render passes, framebuffers and transient
+	///images. Called automatically by record if needed.
+	void compile();
+
+	///Records all passes (with the needed barriers) into the given primary command buffer,
+	///which must be in recording state and outside of a render pass.
+	void record(vk::CommandBuffer cmdBuffer);
+
+	///Returns the passes in the order they are recorded. Only valid after compile.
+	const std::vector<FramePass*>& order() const { return order_; }
+
+	bool compiled() const { return compiled_; }
+	const Stats& stats() const { return stats_; }
+
+	///Returns the image or view of the given image resource.
+	///For transient images only valid after compile.
+	vk::Image vkImage(FrameResource image) const;
+	vk::ImageView vkImageView(FrameResource image) const;
+
+protected:
+	struct Recorder;
+
+	struct ResourceEntry
+	{
+		bool buffer {};
+		bool imported {};
+		ImageInfo info {};
+		vk::ImageUsageFlags usage {};
+		vk::Image image {};
+		vk::ImageView view {};
+		vk::ImageLayout initialLayout {};
+		vk::ImageLayout finalLayout {};
+		vk::Buffer vkBuffer {};
+		vk::DeviceSize offset {};
+		vk::DeviceSize size {};
+
+		//computed by compile
+		int firstUse {-1}; //index in order_
+		int lastUse {-1};
+		unsigned int memory {}; //index in memories_ for transient images
+		vk::DeviceSize memoryOffset {};
+		ResourceStateTracker::State initialState {}; //for transient images
+	};
+
+	void cull();
+	void sort();
+	void allocate();
+	void createRenderPass(FramePass& pass);
+	void createFramebuffer(FramePass& pass);
+	void recordPass(FramePass& pass, vk::CommandBuffer cmdBuffer, bool secondary);
+	void destroyTransients();
+
+protected:
+	unsigned int queueFamily_ {};
+	unsigned int recordThreads_ {};
+	std::vector<ResourceEntry> resources_;
+	std::deque<FramePass> passes_;
+	std::vector<FramePass*> order_;
+	std::vector<std::unique_ptr<DeviceMemory>> memories_;
+	std::vector<FrameResource> reimported_;
+	ResourceStateTracker tracker_;
+	std::unique_ptr<Recorder> recorder_;
+	Stats stats_ {};
+	bool compiled_ {};
+};
+
+}
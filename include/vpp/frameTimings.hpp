@@ -0,0 +1,148 @@
+#pragma once
+
+#include <vpp/fwd.hpp>
+#include <vpp/resource.hpp>
+#include <vpp/submit.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace vpp
+{
+
+///Collects cpu and gpu timings of the last frames of a renderer in a fixed size ring.
+///For every frame the cpu time points of its phases are recorded (see Point) and, if the
+///queue supports timestamps, the duration of its commands on the gpu is measured with
+///timestamp queries written at the beginning and end of its command buffer.
+///The completion of a frame is detected by polling the fence of its submission at the
+///beginning of every frame, so the completion time is only as exact as this polling.
+///Recording a frame does not allocate and only reads the clock a few times, so it can
+///stay enabled. Not threadsafe.
+///\sa SwapChainRenderer::CreateInfo::timingFrames
+class FrameTimings : public Resource
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	///The cpu time points recorded for every frame.
+	enum class Point : unsigned int
+	{
+		acquireBegin,
+		acquireEnd,
+		frameEnd, //RendererBuilder::frame returned
+		recordEnd, //the command buffer was re-recorded (if needed)
+		submitEnd,
+		presentEnd,
+		completed, //the fence of the submission was seen signaled
+		count
+	};
+
+	///Durations that can be summarized, all in milliseconds.
+	enum class Metric : unsigned int
+	{
+		frameTime, //between the beginnings of two consecutive frames
+		acquire, //acquireBegin to acquireEnd
+		frame, //acquireEnd to frameEnd
+		record, //frameEnd to recordEnd
+		submit, //recordEnd to submitEnd
+		present, //submitEnd to presentEnd
+		latency, //acquireBegin to completed
+		gpu, //duration of the commands on the gpu
+		count
+	};
+
+	struct Frame
+	{
+		std::array<Clock::time_point, static_cast<unsigned int>(Point::count)> points {};
+		double gpu {-1.0}; //gpu duration in milliseconds, negative if unknown
+		unsigned int id {}; //id of the timestamp queries, e.g. the render buffer
+		bool query {}; //whether the timestamp queries are used
+		bool completed {};
+	};
+
+	struct Summary
+	{
+		double p50 {};
+		double p99 {};
+		double max {};
+		unsigned int count {}; //the number of frames the metric was known for
+	};
+
+public:
+	///\param capacity The number of frames that are kept.
+	///\param queries The number of timestamp query ids, e.g. the number of command buffers
+	///that are timed. Can be zero to not measure gpu durations.
+	///\param queueFamily The family of the queue the timed commands are submitted to.
+	FrameTimings(const Device& dev, unsigned int capacity, unsigned int queries,
+		unsigned int queueFamily);
+	~FrameTimings();
+
+	FrameTimings(const FrameTimings&) = delete;
+	FrameTimings& operator=(const FrameTimings&) = delete;
+
+	///Polls the pending frames and starts a new frame (replacing the oldest one) by
+	///recording its acquireBegin point.
+	void begin();
+
+	///Records the given time point for the current frame.
+	void mark(Point point);
+
+	///Sets the timestamp query id the current frame uses, i.e. the id whose timestamps were
+	///written by its command buffer (see writeBegin). Since the queries are reused, all
+	///pending frames using the same id are completed first.
+	void query(unsigned int id);
+
+	///Sets the fence that is signaled when the commands of the current frame completed.
+	void submitted(const FenceRef& fence);
+
+	///Checks the pending frames for completion.
+	void poll();
+
+	///Records the commands writing the timestamps for the given id into the given command
+	///buffer. writeBegin must be recorded outside of a render pass.
+	///Do nothing if timestamps are not supported.
+	void writeBegin(vk::CommandBuffer cmdBuffer, unsigned int id) const;
+	void writeEnd(vk::CommandBuffer cmdBuffer, unsigned int id) const;
+
+	///Returns the percentiles and maximum of the given metric over the frames in the ring.
+	Summary summary(Metric metric) const;
+
+	///Writes the frames in the ring (oldest first) as CSV with one row per frame.
+	///The first column ("index") is the position of the frame in the ring, followed by
+	///one column per metric in milliseconds. Unknown values are left empty.
+	void writeCSV(std::ostream& os) const;
+
+	///Returns whether gpu durations are measured.
+	bool timestamps() const { return queryPool_; }
+
+	///Returns the number of timestamp query ids the timings were created with.
+	unsigned int queries() const { return queries_; }
+
+	///Returns the number of frames in the ring.
+	unsigned int size() const { return count_; }
+
+	///Returns the frame with the given age, 0 being the current (last started) one.
+	const Frame& frame(unsigned int age) const;
+
+protected:
+	bool complete(unsigned int index, bool wait);
+	double value(Metric metric, unsigned int age) const;
+
+protected:
+	std::vector<Frame> frames_;
+	std::vector<FenceRef> fences_; //the fences of the pending frames
+	unsigned int current_ {};
+	unsigned int count_ {};
+
+	vk::QueryPool queryPool_ {};
+	unsigned int queries_ {};
+	double timestampPeriod_ {}; //nanoseconds per timestamp tick
+	std::uint64_t timestampMask_ {};
+
+	mutable std::vector<double> values_; //reused for summaries
+};
+
+}
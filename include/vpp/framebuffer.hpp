@@ -14,6 +14,8 @@ namespace vpp
 ///Can be initialized with two step initialization.
 ///Stores its own size and is able to create and manage its own attachments but does
 ///not store any further information such as render pass compatibilty.
+///Owned attachments are created with at least the size of the framebuffer, larger
+///image extents in their create infos are kept.
 class Framebuffer : public ResourceHandle<vk::Framebuffer>
 {
 public:
@@ -45,9 +47,17 @@ public:
 	void init(vk::RenderPass rp, const std::vector<vk::ImageViewCreateInfo>& info,
 		const ExtAttachments& extAttachments = {});
 
+	///Recreates only the vulkan framebuffer with the given size and external attachments
+	///and keeps the owned attachments, which must be at least as large as the given size.
+	///The framebuffer must not be in use anymore.
+	void resize(vk::RenderPass rp, const vk::Extent2D& size, const ExtAttachments& ext = {});
+
 	const std::vector<ViewableImage>& attachments() const { return attachments_; }
 	vk::Extent2D size() const;
 
+protected:
+	void createHandle(vk::RenderPass rp, const ExtAttachments& ext);
+
 protected:
 	std::vector<ViewableImage> attachments_;
 	unsigned int width_ = 0;
@@ -25,6 +25,9 @@ class DescriptorPool;
 class VertexBufferLayout;
 class DescriptorSetLayout;
 class Framebuffer;
+class FrameGraph;
+class FrameTimings;
+class FramePass;
 class RenderPass;
 class CommandPool;
 class CommandBuffer;
@@ -36,6 +39,7 @@ class Device;
 class Queue;
 class RendererBuilder;
 class SwapChainRenderer;
+class OffscreenRenderer;
 class DeviceMemoryAllocator;
 class MemoryEntry;
 class ViewableImage;
@@ -47,6 +51,10 @@ class CommandProvider;
 class DeviceMemoryProvider;
 class HostMemoryProvider;
 class SubmitManager;
+class FencePool;
+class FenceRef;
+class SemaphorePool;
+class CompletionMonitor;
 class WorkManager;
 class TransferManager;
 
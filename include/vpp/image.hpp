@@ -23,6 +23,16 @@ unsigned int formatSize(vk::Format format);
 ///\sa formatSize
 vk::Extent2D blockSize(vk::Format format);
 
+///\{
+///Return the size in bytes of one tightly packed row/slice/region of image data with the
+///given format and size in texels.
+///For compressed formats the size is rounded up to whole blocks, i.e. a row of a
+///compressed image is a row of blocks.
+std::size_t rowPitch(vk::Format format, unsigned int width);
+std::size_t slicePitch(vk::Format format, unsigned int width, unsigned int height);
+std::size_t imageDataSize(vk::Format format, const vk::Extent3D& extent);
+///\}
+
 ///Representing a vulkan image on a device and having its own memory allocation bound to it.
 ///The Image class does not store further information like size, type, format or layout.
 ///All of this must be handled by the application to guarantee the best performance.
@@ -40,23 +50,21 @@ public:
 	Image& operator=(Image&& other) noexcept = default;
 };
 
-//TODO: allow compressed formats. Some way to allow filling a compressed image with
-//	uncompressed data? doing the compressing on the gpu?
-
 ///Fills the given image with data.
 ///There are two different methods for filling an image: memoryMap and transfer.
 ///MemoryMap is used if the image is mappable and the allowMap param is true, otherwise
 ///the transferMethod is used.
 ///Some of the parameters are only needed for one of the two methods. If it is certain
 ///which method is used before calling this function they can be set to any value.
-///\param image The image to retrieve the data from. Must have linear tiling and a non-compressed
-///format. Must not be multisampled and either be created on host visible memory of with the
-///transferDst usage bit set.
+///\param image The image to fill. Must not be multisampled and either be created on
+///host visible memory with linear tiling or with the transferDst usage bit set.
 ///\param data Tightly packed data.
 ///The data must be in row-major order and large enough for the given extent.
-///The size of data will be expected to be extent.w * extent.h * extent.d * formatSize(format).
+///The size of data will be expected to be imageDataSize(format, extent).
 ///\param format The images format. Only important for the size, so if the images format
-///is r8g8b8a8*, passing a8b8g8r8* as format is fine.
+///is r8g8b8a8*, passing a8b8g8r8* as format is fine. For compressed formats the data
+///must consist of rows of blocks and offset and extent must be block-aligned (extent might
+///only be unaligned at the border of the image).
 ///\param layout The layout of the image when this work will be submitted.
 ///Only needed if the image is retrieved per transfer. If the layout is not transferDstOptimal
 ///or the generel it will be changed to transferDstOptimal.
@@ -72,9 +80,36 @@ WorkPtr fill(const Image& image, const std::uint8_t& data, vk::Format format,
 	vk::ImageLayout layout, const vk::Extent3D& extent, const vk::ImageSubresource& subres,
 	const vk::Offset3D& offset = {}, bool allowMap = true);
 
+///Fills multiple regions (e.g. all mip levels and layers of a cubemap) of the given image
+///at once. In comparison to filling every subresource on its own, all data is staged
+///into one transfer buffer range and copied with one command using a single layout transition.
+///\param data One packed block holding the data of all regions.
+///\param regions The regions to fill. The bufferOffset member of a region is the offset
+///of its data in the data block, bufferRowLength and bufferImageHeight can be used as with
+///vkCmdCopyBufferToImage (0 for tightly packed data).
+///\param layout The layout of all filled subresources when this work will be submitted.
+///If the transfer method is used and it is not transferDstOptimal or general, all
+///subresources in the range covering the regions will be changed to transferDstOptimal.
+///For the other parameters, see the fill overload for a single subresource.
+WorkPtr fill(const Image& image, const Range<std::uint8_t>& data, vk::Format format,
+	vk::ImageLayout layout, const Range<vk::BufferImageCopy>& regions, bool allowMap = true);
+
+///Fills the given image with data of a different format, converting it on the fly.
+///The data is converted directly into the mapped memory of the image or the staging buffer,
+///so there is no additional copy. See convertTexels for the supported conversions.
+///\param srcFormat The format of the given data, must not be compressed.
+///\param dstFormat The format of the image.
+///For the other parameters, see the fill overload without conversion.
+///\exception std::logic_error if the formats are not convertible. \sa texelConvertible
+WorkPtr fill(const Image& image, const std::uint8_t& data, vk::Format srcFormat,
+	vk::Format dstFormat, vk::ImageLayout layout, const vk::Extent3D& extent,
+	const vk::ImageSubresource& subres, const vk::Offset3D& offset = {}, bool allowMap = true);
+
 ///Retrieves the data from the given image.
 ///The image must be either allocated on host visible memory or must have the transferSrc bit set
 ///as usage and must not be multisampled.
+///The retrieved data is tightly packed, i.e. has a size of imageDataSize(format, extent).
+///For compressed formats it consists of rows of blocks.
 ///\param allowMap If set to false, the image fill always be filled using a transfer command
 ///rather than mapping its memory. Needed e.g. if the image has an optimal tiling.
 ///\note for 2D images you have to specify extent.z as 1 and NOT as 0.
@@ -83,14 +118,85 @@ DataWorkPtr retrieve(const Image& image, vk::ImageLayout layout, vk::Format form
 	const vk::Offset3D& offset = {}, bool allowMap = true);
 
 
-///XXX: rather use vk::ImageSubresource param instead of only aspects and guessing
+///Fills the base level of the given image with data and generates all other mipmap levels
+///from it by recording a chain of blit commands into the same command buffer.
+///Uses the transfer method of fill and therefore requires the image to have the transferDst
+///and transferSrc usage bits set. The format must support blitting.
+///\param levels The number of mipmap levels to fill (including the base level).
+///The image must have at least this number of levels. \sa mipmapLevels
+///\param finalLayout The layout all levels of the image will have after the work was executed.
+///For the other parameters, see fill.
+///\exception std::logic_error If levels is 0 or the format does not support blitting.
+///\sa generateMipmaps
+WorkPtr fillMipmapped(const Image& image, const std::uint8_t& data, vk::Format format,
+	vk::ImageLayout layout, const vk::Extent3D& extent, unsigned int levels,
+	vk::ImageLayout finalLayout = vk::ImageLayout::shaderReadOnlyOptimal,
+	vk::ImageAspectFlags aspect = vk::ImageAspectBits::color);
+
+///Returns the number of mipmap levels a full mipmap chain for the given extent has.
+unsigned int mipmapLevels(const vk::Extent3D& extent);
+
+///Returns the best filter that can be used for generating mipmaps of the given format.
+///\exception std::logic_error If the format does not support blitSrc and blitDst with
+///optimal tiling.
+vk::Filter mipmapFilter(const Device& dev, vk::Format format);
+
+///Records the commands for generating the mipmap levels [1, levels) of the given image
+///from its base level using a chain of blits.
+///The previous contents of the levels that are generated will be discarded.
+///Must be recorded on a command buffer for a queue that supports graphics operations.
+///\param cmdBuffer Command buffer which must be in recording state
+///\param extent The size of the base level.
+///\param baseLayout The layout of the base level. Writes to the base level must be
+///transfer writes (e.g. by a previous copy), otherwise they must be made visible manually.
+///\param finalLayout The layout all levels will have after the commands were executed.
+///\exception std::logic_error If levels or layers is 0.
+void generateMipmapsCommand(vk::CommandBuffer cmdBuffer, vk::Image image,
+	const vk::Extent3D& extent, unsigned int levels, vk::ImageLayout baseLayout,
+	vk::ImageLayout finalLayout, unsigned int layers = 1,
+	vk::ImageAspectFlags aspect = vk::ImageAspectBits::color,
+	vk::Filter filter = vk::Filter::linear);
+
+///Generates the mipmap levels [1, levels) of the given image from its base level.
+///\exception std::logic_error If the format does not support blitting. \sa mipmapFilter
+///\sa generateMipmapsCommand
+WorkPtr generateMipmaps(const Image& image, vk::Format format, const vk::Extent3D& extent,
+	unsigned int levels, vk::ImageLayout baseLayout,
+	vk::ImageLayout finalLayout = vk::ImageLayout::shaderReadOnlyOptimal,
+	unsigned int layers = 1, vk::ImageAspectFlags aspect = vk::ImageAspectBits::color);
+
+
+///Records the commands for copying the given regions from a buffer (e.g. a manually filled
+///TransferRange) into the given image.
+///If layout is not transferDstOptimal or general, one layout change to transferDstOptimal
+///for the subresource range covering all regions will be recorded before.
+///\param offset The offset in the buffer the bufferOffsets of the regions are relative to.
+void fillCommand(vk::CommandBuffer cmdBuffer, vk::Image image, vk::ImageLayout layout,
+	vk::Buffer buffer, vk::DeviceSize offset, const Range<vk::BufferImageCopy>& regions);
+
+///\{
 ///Records the command for changing an image layout.
+///The access masks and pipeline stages of the barrier are derived from the layouts,
+///see layoutAccess and accessStages. For recording many transitions (or transitions that
+///depend on previous uses) with one barrier, use a ResourceStateTracker instead.
+///The overload only taking aspects only changes the layout of the first mip level and
+///array layer, use the overload taking a range for other or multiple subresources.
 ///\param cmdBuffer Command buffer which must be in recording state
+///\param queueFlags The flags of the queue the command buffer will be submitted to.
 void changeLayoutCommand(vk::CommandBuffer cmdBuffer, vk::Image img, vk::ImageLayout ol,
-	vk::ImageLayout nl, vk::ImageAspectFlags aspects);
+	vk::ImageLayout nl, vk::ImageAspectFlags aspects,
+	vk::QueueFlags queueFlags = vk::QueueBits::graphics | vk::QueueBits::compute);
+void changeLayoutCommand(vk::CommandBuffer cmdBuffer, vk::Image img, vk::ImageLayout ol,
+	vk::ImageLayout nl, const vk::ImageSubresourceRange& range,
+	vk::QueueFlags queueFlags = vk::QueueBits::graphics | vk::QueueBits::compute);
+///\}
+
+///Returns the smallest subresource range covering all given regions.
+vk::ImageSubresourceRange subresourceRange(const Range<vk::BufferImageCopy>& regions);
 
 ///\{
-///Changes the layout of a given vulkan image and returns the associated work ptr.
+///Changes the layout of the first mip level and array layer of a given vulkan image
+///and returns the associated work ptr.
 WorkPtr changeLayout(const Device& dev, vk::Image img, vk::ImageLayout ol, vk::ImageLayout nl,
 	vk::ImageAspectFlags aspect);
 inline WorkPtr changeLayout(const Image& img, vk::ImageLayout ol, vk::ImageLayout nl,
@@ -117,6 +223,12 @@ public:
 	static CreateInfo defaultColor2D();
 	///\}
 
+	///Returns a create info for a sampled 2D texture of the given size and format.
+	///If mipmaps is true, the image has the number of levels needed for a full mipmap chain
+	///(see mipmapLevels) and can be filled using fillMipmapped.
+	static CreateInfo defaultTexture2D(const vk::Extent2D& size,
+		vk::Format format = vk::Format::r8g8b8a8Unorm, bool mipmaps = true);
+
 public:
 	ViewableImage() = default;
 	ViewableImage(const Device& dev, const CreateInfo& info);
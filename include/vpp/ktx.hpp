@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vpp/fwd.hpp>
+#include <vpp/image.hpp>
+#include <vpp/work.hpp>
+#include <vpp/utility/stringParam.hpp>
+
+#include <iosfwd>
+
+namespace vpp
+{
+
+///Describes the texture stored in a ktx (version 1) file.
+struct KtxInfo
+{
+	vk::Format format {}; //the vulkan format matching the glInternalFormat
+	vk::Extent3D extent {}; //size of the base level, unused dimensions are 1
+	unsigned int dimensions {}; //1, 2 or 3
+	unsigned int levels {}; //number of mipmap levels stored in the file
+	unsigned int layers {}; //number of array elements, at least 1
+	unsigned int faces {}; //6 for cubemaps, 1 otherwise
+	bool array {}; //whether the texture is an array texture
+	bool swapEndian {}; //whether the file was written with a different endianess
+
+	///Returns the number of vulkan image layers needed to store the texture.
+	unsigned int imageLayers() const { return layers * faces; }
+
+	///Returns the total number of bytes the texture data has when tightly packed.
+	std::size_t dataSize() const;
+
+	///Returns a create info for a sampled image that can store the whole texture.
+	ViewableImage::CreateInfo createInfo() const;
+};
+
+///Reads the header of a ktx file from the given stream and skips the key/value data.
+///Afterwards the stream points to the texture data and can be passed to fillKtx.
+///\exception std::runtime_error if the stream does not contain a valid ktx file, or the format
+///of the texture is not supported.
+KtxInfo readKtxHeader(std::istream& stream);
+
+///Reads all mipmap levels, layers and faces of a ktx texture from the given stream
+///directly into one staging range and records one copy for all of them.
+///Supports compressed (BCn, ETC2/EAC and ASTC) as well as uncompressed textures.
+///\param image The image to fill. Must have been created with the transferDst usage bit and
+///be able to hold the whole texture (see KtxInfo::createInfo).
+///\param stream Stream pointing to the texture data, i.e. after the header was read.
+///\param info The information read from the header of the file.
+///\param layout The layout of the image when the returned work will be submitted. All
+///subresources will be in transferDstOptimal layout after the work was executed.
+///\exception std::runtime_error if the stream does not contain enough data.
+WorkPtr fillKtx(const Image& image, std::istream& stream, const KtxInfo& info,
+	vk::ImageLayout layout = vk::ImageLayout::undefined);
+
+///Creates an image for the ktx file at the given path and fills it with its contents.
+///The returned image will only be usable once the work stored in the given work parameter
+///has finished.
+///\exception std::runtime_error if the file cannot be opened or is not a valid ktx file.
+ViewableImage loadKtx(const Device& dev, const StringParam& path, WorkPtr& work,
+	KtxInfo* info = nullptr);
+
+}
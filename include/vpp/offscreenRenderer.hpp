@@ -0,0 +1,145 @@
+#pragma once
+
+#include <vpp/fwd.hpp>
+#include <vpp/resource.hpp>
+#include <vpp/framebuffer.hpp>
+#include <vpp/commandBuffer.hpp>
+#include <vpp/readback.hpp>
+#include <vpp/renderer.hpp>
+#include <vpp/submit.hpp>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace vpp
+{
+
+///Renders with a RendererBuilder into images instead of a swap chain, e.g. on headless
+///servers or for benchmarks on devices without a window system (see createHeadlessContext).
+///Renders into a ring of targets, each with its own framebuffer (and attachments) and its own
+///prerecorded command buffer. The targets are used in turn, so up to CreateInfo::targets
+///frames may be executed on the gpu at the same time and render only waits for the
+///oldest frame when the ring wraps around.
+///Optionally one attachment is copied into a ReadbackStream after every frame, so the
+///rendered images can be retrieved on the host without stalling (with the latency of
+///some frames), see readback.
+///The RendererBuilder is used as with a SwapChainRenderer, the ids passed to it are the
+///indices of the targets. Secondary command buffers are not supported.
+///Is not threadsafe, must be synchronized externally.
+class OffscreenRenderer : public Resource
+{
+public:
+	///Typedef for the renderer builder implementation.
+	using RenderImpl = std::unique_ptr<RendererBuilder>;
+
+	struct CreateInfo
+	{
+		vk::RenderPass renderPass; //the render pass to use for the rendering
+		unsigned int queueFamily; //the queue family for graphical operations
+		vk::Extent2D size; //the size of the framebuffers
+		Framebuffer::AttachmentsInfo attachments; //created for every target
+		Framebuffer::ExtAttachments external; //additional attachments shared by all targets
+
+		//The number of targets in the ring, i.e. the number of frames that may be in flight.
+		unsigned int targets = 2;
+
+		//If not negative, the attachment with this index in attachments is read back
+		//after every frame. The render pass must leave it in readbackLayout, which must
+		//be transferSrcOptimal or general.
+		int readbackAttachment = -1;
+		vk::ImageLayout readbackLayout = vk::ImageLayout::transferSrcOptimal;
+
+		//The number of readback slots. If zero, two more than targets are used.
+		unsigned int readbackSlots = 0;
+
+		//If not zero, the timings of this number of last frames are recorded, see timings.
+		unsigned int timingFrames = 0;
+	};
+
+	struct Target
+	{
+		Framebuffer framebuffer;
+		CommandBuffer commandBuffer; //the prerecorded render commands
+		CommandBuffer readbackBuffer; //records the readback copy every frame
+		FenceRef fence; //signaled when the last frame rendered into this target completed
+		bool dirty {}; //whether the command buffer is re-recorded before its next submission
+	};
+
+public:
+	OffscreenRenderer(const Device& dev, const CreateInfo& info, RenderImpl builder);
+	~OffscreenRenderer();
+
+	OffscreenRenderer(OffscreenRenderer&&) = delete;
+	OffscreenRenderer& operator=(OffscreenRenderer&&) = delete;
+
+	///Renders one frame into the next target and returns the state of its submission.
+	///Only blocks if the frame previously rendered into the target was not completed yet.
+	///\param queue The queue to submit the commands to. If it is nullptr, a queue of the
+	///render queue family will be selected.
+	///\exception std::logic_error If there is no queue for the render queue family.
+	CommandExecutionState render(const Queue* queue = nullptr);
+
+	///Renders one frame and waits until all rendering operations are finished.
+	void renderBlock(const Queue* queue = nullptr);
+
+	///Recreates all targets with the given size and re-records their command buffers.
+	///Waits for all rendered frames before. Results not yet read back are discarded.
+	void resize(const vk::Extent2D& size);
+
+	///Calls the builder to build the command buffer for the target with the given id.
+	///\param id The id of the target to (re)record. If it is -1, all targets will be recorded.
+	void record(int id = -1);
+
+	///Marks the target with the given id (or all targets if id is -1) as outdated, it is
+	///re-recorded just before it is rendered the next time.
+	///\sa SwapChainRenderer::invalidate
+	void invalidate(int id = -1);
+
+	///Returns the data of the newest readback that completed. Does never block.
+	///Returns an empty range if there is none or readback is not used.
+	///The returned data stays valid until the next call of this function.
+	///The texels are tightly packed in rows.
+	///\param frame If not nullptr, the number of the frame (counting from 1) whose
+	///rendered image is returned is stored in it.
+	Range<std::uint8_t> readback(std::uint64_t* frame = nullptr);
+
+	///Returns the index of the target that is currently rendered (e.g. during
+	///RendererBuilder::frame or submit) or was rendered last.
+	unsigned int current() const { return current_; }
+
+	///Returns the number of frames rendered so far.
+	std::uint64_t frameCount() const { return frameCount_; }
+
+	///Returns the timings of the last rendered frames or nullptr if they are not recorded.
+	///Since nothing is presented, the present duration of the frames is unknown.
+	const FrameTimings* timings() const { return timings_.get(); }
+
+	const std::vector<Target>& targets() const { return targets_; }
+	const vk::Extent2D& size() const { return info_.size; }
+	vk::RenderPass vkRenderPass() const { return info_.renderPass; }
+	unsigned int renderQueueFamily() const { return info_.queueFamily; }
+
+protected:
+	void createTargets();
+	void waitTargets();
+	void recycleTargets();
+	void recordTarget(unsigned int id);
+	vk::Fence recordReadback(Target& target);
+
+protected:
+	CreateInfo info_;
+	RenderImpl renderImpl_;
+	std::vector<Target> targets_;
+	unsigned int current_ {};
+	std::uint64_t frameCount_ {};
+
+	ReadbackStream readback_;
+	std::deque<std::pair<std::uint64_t, std::uint64_t>> readbackFrames_; //(id, frame) per readback
+	vk::BufferImageCopy readbackRegion_ {};
+	std::uint64_t readbackCount_ {}; //the id of the last recorded readback
+
+	std::unique_ptr<FrameTimings> timings_;
+};
+
+}
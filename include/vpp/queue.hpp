@@ -32,10 +32,9 @@ public:
 	vk::Queue vkQueue() const { return queue_; }
 	vk::Queue vkHandle() const { return queue_; }
 
-	///The queue must be locked before performing any operations (such as presenting or sparse
-	///binding) on the queue.
-	///Note that locking the queues mutex is not enough for submitting command buffers to the queue,
-	///since while submitting, no operation on ANY queue is allowed.
+	///The queue must be locked before performing any operations (such as submitting, presenting
+	///or sparse binding) on the queue.
+	///Prefer SubmitManager::acquire(queue) over using the mutex directly.
 	///To submit command buffers to a queue, use the SubmitManager class.
 	///\sa SubmitManager
 	std::mutex& mutex() const { return mutex_; }
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vpp/fwd.hpp>
+#include <vpp/resource.hpp>
+#include <vpp/buffer.hpp>
+#include <vpp/memory.hpp>
+#include <vpp/submit.hpp>
+#include <vpp/utility/range.hpp>
+
+#include <vector>
+
+namespace vpp
+{
+
+///Continuous readback pipeline for data that is downloaded from the device every frame
+///(e.g. compute outputs, picking buffers or statistics).
+///Owns a ring of persistently mapped (host cached if possible) download slots.
+///In comparison to retrieve it does not allocate or record any command buffer itself but
+///rather records the copy commands into a command buffer given by the caller, which can
+///then simply be submitted together with the frames other commands.
+///The newest completed slot can be queried without blocking, so the readback latency is
+///the number of slots (frames) but there will never be any stall.
+///Is not threadsafe, must be synchronized externally.
+class ReadbackStream : public Resource
+{
+public:
+	ReadbackStream() = default;
+
+	///Creates a readback stream with the given number of slots, each capable of storing
+	///size bytes. There should be at least two slots more than frames in flight since the
+	///newest completed slot and the one returned by latest are never reused.
+	ReadbackStream(const Device& dev, std::size_t size, unsigned int slots = 3);
+	~ReadbackStream();
+
+	ReadbackStream(ReadbackStream&& other) noexcept { swap(*this, other); }
+	ReadbackStream& operator=(ReadbackStream other) noexcept { swap(*this, other); return *this; }
+
+	///Records the command for copying the given buffer range into the next free slot
+	///into the given command buffer, which must be in recording state.
+	///If size is 0, the whole slot size will be copied.
+	///Returns the fence of the used slot which MUST be signaled by the submission that
+	///executes the given command buffer (i.e. passed as fence to vkQueueSubmit).
+	///If there is currently no free slot (i.e. all slots are still pending) nothing will
+	///be recorded and a null handle will be returned. The caller should then simply skip
+	///the readback for this frame.
+	vk::Fence record(vk::CommandBuffer cmdBuffer, vk::Buffer src, std::size_t offset = 0,
+		std::size_t size = 0);
+
+	///Records the command for copying the given image regions into the next free slot.
+	///The buffer offsets of the given regions are relative to the beginning of the slot
+	///and must be in range of its size.
+	///The image must be in the given layout (transferSrcOptimal or general) when the
+	///commands are executed.
+	///\sa record(vk::CommandBuffer, vk::Buffer, std::size_t, std::size_t)
+	vk::Fence record(vk::CommandBuffer cmdBuffer, vk::Image src, vk::ImageLayout layout,
+		const Range<vk::BufferImageCopy>& regions);
+
+	///Returns the data of the newest slot whose commands were completed.
+	///Does never block. Returns an empty range if there is no completed readback.
+	///The returned data stays valid until the next call of this function (the slot it
+	///references will not be reused before).
+	///\param id If not nullptr, the id of the returned readback will be stored in it.
+	///The first recorded readback has the id 1, the id is increased by 1 for every record call.
+	Range<std::uint8_t> latest(std::uint64_t* id = nullptr);
+
+	///Returns the size of each slot in bytes.
+	std::size_t size() const { return size_; }
+
+	///Returns the number of slots, i.e. the maximal number of readbacks in flight.
+	unsigned int slotCount() const { return slots_.size(); }
+
+	friend void swap(ReadbackStream& a, ReadbackStream& b) noexcept;
+
+protected:
+	struct Slot
+	{
+		Buffer buffer;
+		MemoryMapView map;
+		Fence fence;
+		std::uint64_t id {}; //0 if the slot was never used
+		bool pending {}; //whether the fence was not yet seen signaled
+	};
+
+	Slot* nextSlot();
+	void update();
+
+protected:
+	std::vector<Slot> slots_;
+	std::size_t size_ {};
+	std::uint64_t recorded_ {}; //id of the last recorded readback
+	Slot* latest_ {}; //newest completed slot, will not be reused
+	Slot* exposed_ {}; //slot returned by the last latest call, will not be reused
+};
+
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <vpp/fwd.hpp>
+#include <vpp/vulkan/enums.hpp>
+#include <vpp/vulkan/structs.hpp>
+#include <vpp/utility/range.hpp>
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+namespace vpp
+{
+
+///A single draw call together with all the state it needs.
+///Batches of draw packets can be recorded by a CommandRecorder which sorts them by their
+///state so that as few bind commands as possible are needed.
+struct DrawPacket
+{
+	static constexpr auto maxDescriptorSets = 4u;
+
+	vk::Pipeline pipeline {};
+	vk::PipelineLayout pipelineLayout {};
+	std::array<vk::DescriptorSet, maxDescriptorSets> descriptorSets {}; //bound starting at set 0
+	unsigned int descriptorSetCount {};
+
+	vk::Buffer vertexBuffer {}; //bound to binding 0, ignored if null
+	vk::DeviceSize vertexBufferOffset {};
+	vk::Buffer indexBuffer {}; //if null, the draw is not indexed
+	vk::DeviceSize indexBufferOffset {};
+	vk::IndexType indexType {vk::IndexType::uint16};
+
+	std::uint32_t count {}; //vertex or index count
+	std::uint32_t instanceCount {1};
+	std::uint32_t first {}; //first vertex or index
+	std::int32_t vertexOffset {}; //only used for indexed draws
+	std::uint32_t firstInstance {};
+};
+
+///Records commands into a command buffer while tracking the bound pipeline, descriptor sets,
+///vertex and index buffers as well as the viewport and scissor and drops all bind or set
+///commands that would not change anything.
+///Binding descriptor sets with a pipeline layout different from the one they were last bound
+///with always records them and invalidates all other tracked sets of the bind point.
+///If commands are recorded directly into the command buffer (or secondary command buffers
+///are executed) reset must be called, since the tracked state may be invalid afterwards.
+///Counts all bind and set calls before and after deduplication, see stats.
+class CommandRecorder
+{
+public:
+	///The number of bind or set operations that were requested and that were recorded.
+	///For descriptor sets and vertex buffers every set or binding is counted.
+	struct BindCount
+	{
+		unsigned int requested {};
+		unsigned int recorded {};
+	};
+
+	struct Stats
+	{
+		BindCount pipelines;
+		BindCount descriptorSets;
+		BindCount vertexBuffers;
+		BindCount indexBuffers;
+		BindCount dynamicState; //viewport and scissor
+		unsigned int draws {};
+	};
+
+public:
+	CommandRecorder() = default;
+	CommandRecorder(vk::CommandBuffer cmdBuffer) : commandBuffer_(cmdBuffer) {}
+
+	void bindPipeline(vk::PipelineBindPoint bindPoint, vk::Pipeline pipeline);
+	void bindDescriptorSets(vk::PipelineBindPoint bindPoint, vk::PipelineLayout layout,
+		unsigned int firstSet, const Range<vk::DescriptorSet>& sets,
+		const Range<std::uint32_t>& dynamicOffsets = {});
+	void bindVertexBuffers(unsigned int firstBinding, const Range<vk::Buffer>& buffers,
+		const Range<vk::DeviceSize>& offsets);
+	void bindIndexBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::IndexType type);
+
+	///Sets the first viewport or scissor.
+	void setViewport(const vk::Viewport& viewport);
+	void setScissor(const vk::Rect2D& scissor);
+
+	void draw(std::uint32_t vertexCount, std::uint32_t instanceCount = 1,
+		std::uint32_t firstVertex = 0, std::uint32_t firstInstance = 0);
+	void drawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount = 1,
+		std::uint32_t firstIndex = 0, std::int32_t vertexOffset = 0,
+		std::uint32_t firstInstance = 0);
+
+	///Binds the state of the given packet (if needed) and records its draw call.
+	void draw(const DrawPacket& packet);
+
+	///Records the given draw packets. If sort is true, they are recorded ordered by
+	///pipeline, descriptor sets and buffers, otherwise in the given order.
+	void draw(const Range<DrawPacket>& packets, bool sort = true);
+
+	///Forgets all tracked state, i.e. the next bind or set calls will always be recorded.
+	void reset();
+
+	///Resets the bind statistics.
+	void resetStats() { stats_ = {}; }
+
+	const Stats& stats() const { return stats_; }
+	vk::CommandBuffer vkCommandBuffer() const { return commandBuffer_; }
+
+protected:
+	static constexpr auto maxDescriptorSets = 8u;
+	static constexpr auto maxVertexBindings = 16u;
+
+	struct BindPointState
+	{
+		vk::Pipeline pipeline {};
+		vk::PipelineLayout layout {};
+		std::array<vk::DescriptorSet, maxDescriptorSets> sets {};
+	};
+
+protected:
+	vk::CommandBuffer commandBuffer_ {};
+	std::array<BindPointState, 2> bindPoints_ {}; //graphics, compute
+	std::array<vk::Buffer, maxVertexBindings> vertexBuffers_ {};
+	std::array<vk::DeviceSize, maxVertexBindings> vertexOffsets_ {};
+	vk::Buffer indexBuffer_ {};
+	vk::DeviceSize indexOffset_ {};
+	vk::IndexType indexType_ {};
+	vk::Viewport viewport_ {};
+	vk::Rect2D scissor_ {};
+	bool viewportValid_ {};
+	bool scissorValid_ {};
+	Stats stats_ {};
+	std::vector<const DrawPacket*> sorted_; //reused for sorting packets
+};
+
+}
@@ -5,6 +5,9 @@
 #include <vpp/framebuffer.hpp>
 #include <vpp/renderPass.hpp>
 #include <vpp/image.hpp>
+#include <vpp/submit.hpp>
+#include <vpp/swapChain.hpp>
+#include <vpp/frameTimings.hpp>
 
 #include <memory>
 #include <vector>
@@ -21,8 +24,17 @@ public:
 
 public:
 	///This function is called to record the render commands into the given renderpass instance.
+	///Only called if the SwapChainRenderer does not use secondary command buffers.
 	virtual void build(unsigned int id, const RenderPassInstance& ini) = 0;
 
+	///Called to record the render commands for the given part of the render buffer with the
+	///given id if the SwapChainRenderer uses secondary command buffers
+	///(see SwapChainRenderer::CreateInfo::secondaryBuffers).
+	///The command buffer of the given instance is a secondary command buffer that is inside
+	///the render pass and has viewport and scissor already set.
+	///Called concurrently from multiple threads (also for the same id), so must be threadsafe.
+	virtual void buildSecondary(unsigned int, unsigned int, const RenderPassInstance&) {}
+
 	///Should return the clearValues for the given render buffer id.
 	virtual std::vector<vk::ClearValue> clearValues(unsigned int id) = 0;
 
@@ -30,6 +42,11 @@ public:
 	///and before it will use any other builder functions.
 	virtual void init(SwapChainRenderer&) {};
 
+	///Called once by an OffscreenRenderer, after it was constructed and before it will use
+	///any other builder functions. The command buffers of the OffscreenRenderer are recorded
+	///after this function returns.
+	virtual void init(OffscreenRenderer&) {};
+
 	///Will be called to record additional command buffer commands before rendering.
 	virtual void beforeRender(vk::CommandBuffer) {};
 
@@ -57,6 +74,8 @@ public:
 	///This function is called before every frame and allows the builder to execute/queue
 	///additional operations or to re-record the command buffer for the given id.
 	///It is called exactly before the command buffer for the given id is queued for submission.
+	///Instead of recording directly, the builder can also invalidate the render buffer
+	///(see SwapChainRenderer::invalidate), it is then re-recorded after this function returns.
 	virtual void frame(unsigned int id) {};
 };
 
@@ -104,6 +123,25 @@ public:
 		//terms of memory allocation
 		unsigned int maxWidth = 1920;
 		unsigned int maxHeight = 1080;
+
+		//If not zero, the render commands are recorded into this number of secondary command
+		//buffers per render buffer by worker threads (see RendererBuilder::buildSecondary)
+		//and the primary command buffers only execute them.
+		unsigned int secondaryBuffers = 0;
+
+		//The number of worker threads used to record the secondary command buffers.
+		//If zero, the number of hardware threads is used.
+		unsigned int recordThreads = 0;
+
+		//If not zero, up to this number of frames may be executed on the gpu at the same time.
+		//Every frame in flight has its own acquire semaphore and fence and render only waits
+		//for the fence of the oldest frame when the ring wraps around, so the returned works
+		//do not have to be kept alive or waited on. See frameIndex.
+		unsigned int framesInFlight = 0;
+
+		//If not zero, the cpu and gpu timings of this number of last rendered frames are
+		//recorded, see timings.
+		unsigned int timingFrames = 0;
 	};
 
 	///The RenderBuffer class hold a framebuffer for each swapChain image as well a
@@ -116,6 +154,10 @@ public:
 	{
 		Framebuffer framebuffer;
 		CommandBuffer commandBuffer;
+		PooledSemaphore renderComplete; //signaled when rendering into the image is finished
+		std::vector<CommandBuffer> secondaryBuffers; //only used with CreateInfo::secondaryBuffers
+		FenceRef fence; //signaled when the last submission of the command buffer completed
+		bool dirty {}; //whether the command buffer is re-recorded before its next submission
 	};
 
 	///Convinience typedef for the rendering work and presentation work.
@@ -126,14 +168,15 @@ public:
 
 public:
 	SwapChainRenderer() = default;
-	SwapChainRenderer(const SwapChain& swapChain, const CreateInfo& info, RenderImpl builder);
+	SwapChainRenderer(SwapChain& swapChain, const CreateInfo& info, RenderImpl builder);
 	~SwapChainRenderer();
 
 	SwapChainRenderer(SwapChainRenderer&& other) noexcept;
 	SwapChainRenderer& operator=(SwapChainRenderer other) noexcept;
 
 	///Creates all static attachments and all framebuffers.
-	void create(const SwapChain& swapChain, const CreateInfo& info);
+	///The swap chain is recreated by the renderer when it gets out of date, see resize.
+	void create(SwapChain& swapChain, const CreateInfo& info);
 
 	///Initialized all attachments and creates the vulkan framebuffers.
 	void init(RenderImpl builder);
@@ -146,7 +189,8 @@ public:
 	///\exception std::logic_error If a valid present or graphics queue cannot be found or if
 	///the family of the grahpics queue is not compatible with the recorded command buffers.
 	///\return A Work pointer that can be used to track the state or wait for the rendering
-	///to finish.
+	///to finish. If no frame could be rendered since the swap chain is out of date even after
+	///recreating it (e.g. for a minimized window), an already finished work is returned.
 	RenderWork render(const Queue* present = nullptr, const Queue* graphics = nullptr);
 
 	///Renders one frame and waits until all rendering operations are finished.
@@ -157,10 +201,51 @@ public:
 	///the family of the grahpics queue is not compatible with the recorded command buffers.
 	void renderBlock(const Queue* present = nullptr, const Queue* graphics = nullptr);
 
+	///Recreates the swap chain (passing the old one as oldSwapchain) with the given parameters
+	///(see SwapChain::resize) and the framebuffers for its new images and re-records all
+	///command buffers. Waits only for the previously rendered frames, not for the device.
+	///The attachments are only recreated if the new size exceeds the size they were
+	///created with (at least CreateInfo::maxWidth and maxHeight) or the number of swap chain
+	///images changed, otherwise they are kept and only the framebuffers are recreated.
+	///Called automatically by render if the swap chain is out of date or suboptimal.
+	void resize(const vk::Extent2D& size = {}, const SwapChainSettings& settings = {});
+
+	///Returns whether the last acquire or present reported the swap chain as out of date
+	///or suboptimal, i.e. whether it will be recreated before the next frame is rendered.
+	bool outdated() const { return outdated_; }
+
 	///Calls the builder to build the commandBuffer with the given id.
+	///If secondary command buffers are used, they are recorded in parallel by the worker
+	///threads (for all render buffers at once if id is -1) and this function returns
+	///when all of them are recorded.
 	///\param id The id of the render buffer to (re)record. If it is -1, all buffers will be recorded.
 	void record(int id = -1);
 
+	///Marks the render buffer with the given id (or all render buffers if id is -1) as
+	///outdated. Instead of re-recording them directly (as record does), every invalidated
+	///render buffer is re-recorded just before it is submitted the next time, so only the
+	///command buffers that are actually used are recorded and at most once per frame.
+	///Should be called e.g. when the scene changed. Can also be called by the builder
+	///in RendererBuilder::frame.
+	void invalidate(int id = -1);
+
+	///Returns whether the render buffer with the given id was invalidated and not
+	///re-recorded since then.
+	bool dirty(unsigned int id) const { return renderBuffers_[id].dirty; }
+
+	///Returns the index of the frame in flight that is currently rendered (e.g. during
+	///RendererBuilder::frame or submit) or was rendered last.
+	///Resources written by the cpu every frame (like uniform buffers) can be duplicated for
+	///every frame in flight and updated using this index since the gpu has finished using
+	///them when the frame is rendered again. Always 0 if frames in flight are not used.
+	unsigned int frameIndex() const { return frameIndex_; }
+	unsigned int framesInFlight() const { return info_.framesInFlight; }
+
+	///Returns the timings of the last rendered frames or nullptr if they are not recorded
+	///(see CreateInfo::timingFrames). The gpu durations of the frames are only known after
+	///the timings were polled, which is done at the beginning of every frame.
+	const FrameTimings* timings() const { return timings_.get(); }
+
 	const SwapChain& swapChain() const { return *swapChain_; }
 	const std::vector<RenderBuffer>& renderBuffers() const { return renderBuffers_; }
 	const std::vector<ViewableImage>& staticAttachments() const { return staticAttachments_; }
@@ -174,11 +259,43 @@ public:
 	friend void swap(SwapChainRenderer& a, SwapChainRenderer& b) noexcept;
 
 protected:
-	const SwapChain* swapChain_ = nullptr;
+	struct Recorder;
+
+	///A frame that may be in flight.
+	struct Frame
+	{
+		PooledSemaphore acquireComplete;
+		FenceRef fence; //signaled when the commands of the frame have completed
+	};
+
+	void createAttachments();
+	void initFramebuffers();
+	Framebuffer::ExtAttachments sharedAttachments() const;
+	void waitFrames();
+	void recycleBuffers();
+
+	///Acquires an image, submits the render commands for it and presents it.
+	///Returns false if no frame could be rendered since the swap chain is out of date
+	///even after it was recreated.
+	bool renderFrame(const Queue& present, const Queue& gfx, CommandExecutionState& state);
+
+	void recordPrimary(unsigned int id);
+	void recordSecondary(unsigned int id, unsigned int index);
+	void queueSecondary(unsigned int id);
+
+protected:
+	SwapChain* swapChain_ = nullptr;
 	RenderImpl renderImpl_ = nullptr;
 	std::vector<RenderBuffer> renderBuffers_;
 	std::vector<ViewableImage> staticAttachments_;
 	CreateInfo info_;
+	std::unique_ptr<Recorder> recorder_; //worker threads for the secondary command buffers
+	std::vector<Frame> frames_; //ring of frames in flight
+	unsigned int frameIndex_ {};
+	FenceRef lastFence_; //signaled when the last rendered frame completed
+	vk::Extent2D attachmentSize_ {}; //the size the attachments were created with
+	bool outdated_ {};
+	std::unique_ptr<FrameTimings> timings_; //only if CreateInfo::timingFrames is not zero
 };
 
 }
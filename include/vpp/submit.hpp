@@ -3,10 +3,17 @@
 #include <vpp/fwd.hpp>
 #include <vpp/device.hpp>
 #include <vpp/resource.hpp>
+#include <vpp/utility/range.hpp>
 
 #include <unordered_map>
 #include <vector>
+#include <deque>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 
 namespace vpp
 {
@@ -29,39 +36,217 @@ protected:
 	vk::Fence fence_ {};
 };
 
-///Can be used to track the state of a queued command buffer or to submit it to the device.
-class CommandExecutionState : public Resource
+///Reference to a fence owned by a FencePool.
+///Copying a reference only increments an intrusive reference count, i.e. there is no
+///allocation involved. When the last reference is destroyed, the fence is returned to the pool
+///which will reuse it as soon as it is signaled.
+class FenceRef
 {
 public:
-	using FencePtr = std::shared_ptr<Fence>;
+	FenceRef() = default;
+	~FenceRef();
+
+	FenceRef(const FenceRef& other) noexcept;
+	FenceRef& operator=(FenceRef other) noexcept { swap(*this, other); return *this; }
+	FenceRef(FenceRef&& other) noexcept { swap(*this, other); }
+
+	vk::Fence vkFence() const;
+	operator vk::Fence() const { return vkFence(); }
+	explicit operator bool() const { return entry_; }
+
+	friend void swap(FenceRef& a, FenceRef& b) noexcept { std::swap(a.entry_, b.entry_); }
 
+protected:
+	friend class FencePool;
+	struct Entry;
+	FenceRef(Entry& entry) noexcept : entry_(&entry) {}
+
+protected:
+	Entry* entry_ {};
+};
+
+///Pooled fence with its intrusive reference count.
+struct FenceRef::Entry
+{
+	FencePool& pool;
+	vk::Fence fence;
+	std::atomic<unsigned int> references {};
+
+	Entry(FencePool& p, vk::Fence f) : pool(p), fence(f) {}
+};
+
+///Recycles fences for a device, so that submitting work does not require a fence creation.
+///Fences are returned to the pool once all references to them are destroyed and are reset
+///when they are reused after they were signaled. Fences that were returned to the pool
+///but are never signaled are not reused.
+///There is always only one FencePool for a vulkan device. Threadsafe.
+class FencePool : public Resource
+{
 public:
-	CommandExecutionState() = default;
-	CommandExecutionState(const Device& dev, CommandExecutionState** ptr);
-	~CommandExecutionState();
+	///Returns an unsignaled fence. Reuses a signaled fence that was returned to the pool
+	///if there is one, otherwise creates a new one.
+	FenceRef get();
 
-	CommandExecutionState(CommandExecutionState&& other) noexcept;
-	CommandExecutionState& operator=(CommandExecutionState&& other) noexcept;
+	///Returns the number of fences that were created by this pool.
+	std::size_t created() const { return created_.load(); }
 
-	///Makes sure the commands associated with this control are submitted to the gpu.
-	void submit();
+	///Returns the number of times a returned fence was reused instead of creating a new one.
+	std::size_t reused() const { return reused_.load(); }
 
-	///Waits for the commands associated with this control to finish.
-	///Will wait at least for the given timeout on nanoseconds.
-	void wait(std::uint64_t timeout = ~std::uint64_t(0));
+protected:
+	friend class Device;
+	friend class FenceRef;
 
-	///Returns whether the commands were submitted to the gpu.
-	bool submitted() const;
+	FencePool(const Device& dev);
+	~FencePool();
 
-	///Returns whether execution of the associated commands have been finished.
-	bool completed() const;
+	void release(FenceRef::Entry& entry);
 
-	bool valid() const { return self_; }
+protected:
+	std::mutex mutex_;
+	std::deque<FenceRef::Entry> entries_; //deque for stable references
+	std::deque<FenceRef::Entry*> unused_; //in the order they were returned
+	std::atomic<std::size_t> created_ {};
+	std::atomic<std::size_t> reused_ {};
+};
+
+class CommandExecutionState;
+
+///Semaphore owned by a SemaphorePool.
+///Returns the semaphore to the pool on destruction, so it must not be used by any pending
+///operation anymore at this point. Use SemaphorePool::recycle to return it to the pool
+///once the submission waiting on it has completed instead.
+class PooledSemaphore
+{
+public:
+	PooledSemaphore() = default;
+	~PooledSemaphore();
+
+	PooledSemaphore(PooledSemaphore&& other) noexcept { swap(*this, other); }
+	PooledSemaphore& operator=(PooledSemaphore other) noexcept
+		{ swap(*this, other); return *this; }
+
+	const vk::Semaphore& vkHandle() const { return semaphore_; }
+	operator vk::Semaphore() const { return semaphore_; }
+	explicit operator bool() const { return semaphore_; }
+
+	friend void swap(PooledSemaphore& a, PooledSemaphore& b) noexcept;
 
 protected:
-	friend class SubmitManager;
-	FencePtr fence_;
-	CommandExecutionState** self_ {}; //pointer to the a unique_ptr in SubmitManager (Submission)
+	friend class SemaphorePool;
+	PooledSemaphore(SemaphorePool& pool, vk::Semaphore semaphore)
+		: pool_(&pool), semaphore_(semaphore) {}
+
+protected:
+	SemaphorePool* pool_ {};
+	vk::Semaphore semaphore_ {};
+};
+
+///Recycles semaphores for a device, e.g. for the acquire/render semaphores of a renderer or
+///for dependencies between queues. Semaphores are only reused once the submission that
+///waited on them has completed.
+///There is always only one SemaphorePool for a vulkan device. Threadsafe.
+class SemaphorePool : public Resource
+{
+public:
+	///Returns an unsignaled semaphore. Reuses a returned semaphore if there is one, otherwise
+	///creates a new one.
+	PooledSemaphore get();
+
+	///Returns the given semaphore to the pool as soon as the given state completed.
+	///The state must belong to the submission that waits on the semaphore.
+	///Submits the state if it was not yet submitted.
+	void recycle(PooledSemaphore&& semaphore, CommandExecutionState& waiter);
+
+	///Returns the given semaphore to the pool as soon as the given fence is signaled.
+	///The fence must be signaled by the submission that waits on the semaphore.
+	void recycle(PooledSemaphore&& semaphore, const FenceRef& fence);
+
+	///Returns the number of semaphores that were created by this pool.
+	std::size_t created() const { return created_.load(); }
+
+	///Returns the number of times a returned semaphore was reused instead of creating a new one.
+	std::size_t reused() const { return reused_.load(); }
+
+protected:
+	friend class Device;
+	friend class PooledSemaphore;
+
+	SemaphorePool(const Device& dev);
+	~SemaphorePool();
+
+	void release(vk::Semaphore semaphore);
+
+protected:
+	std::mutex mutex_;
+	std::vector<vk::Semaphore> semaphores_; //all semaphores, for destruction
+	std::vector<vk::Semaphore> unused_;
+	std::vector<std::pair<vk::Semaphore, FenceRef>> recycled_; //waiting for their fence
+	std::atomic<std::size_t> created_ {};
+	std::atomic<std::size_t> reused_ {};
+};
+
+///Runs callbacks once the gpu has completed the submissions they were registered for.
+///Completions are detected either by calling poll (e.g. once per frame, see
+///Device::pollCompletions) or by a thread that waits for the pending fences.
+///The callbacks are run by the polling thread or passed to the executor, if there is one.
+///There is always only one CompletionMonitor for a vulkan device. Threadsafe.
+class CompletionMonitor : public Resource
+{
+public:
+	using Callback = std::function<void()>;
+	using Executor = std::function<void(Callback)>;
+
+public:
+	///Runs the given callback once the given fence is signaled.
+	///If the fence is invalid, the callback is run on the next poll.
+	void add(const FenceRef& fence, Callback callback);
+
+	///Runs the given callback once the commands of the given state have completed.
+	///Does not submit the state, the callback is registered with the pending submission.
+	///If the state is invalid, the callback is run on the next poll.
+	void add(const CommandExecutionState& state, Callback callback);
+
+	///Runs (or passes to the executor) all callbacks whose submissions have completed.
+	///If a callback throws, the other callbacks are still run and the first exception is
+	///rethrown afterwards. Returns the number of completed callbacks.
+	std::size_t poll();
+
+	///Sets the executor that is used to run the callbacks, e.g. to run them on a thread pool.
+	///If it is empty (the default), the callbacks are run by the thread that polls.
+	void executor(Executor executor);
+
+	///Starts a thread that waits for the pending fences and runs the callbacks as soon as
+	///they complete. Callbacks added while it waits are noticed after at most the given
+	///interval. If the thread is already running, only changes the interval.
+	void startThread(std::chrono::nanoseconds interval = std::chrono::milliseconds(1));
+
+	///Stops the monitor thread if it is running.
+	void stopThread();
+
+	///Returns whether the monitor thread is running.
+	bool threaded() const { return threadRun_.load(); }
+
+	///Returns the number of callbacks that were not yet run.
+	std::size_t pending() const;
+
+protected:
+	friend class Device;
+
+	CompletionMonitor(const Device& dev);
+	~CompletionMonitor();
+
+	void threadMain();
+
+protected:
+	mutable std::mutex mutex_;
+	std::vector<std::pair<FenceRef, Callback>> callbacks_; //in the order they were added
+	Executor executor_;
+
+	std::thread thread_;
+	std::condition_variable threadCV_; //waited on with mutex_ if there are no callbacks
+	std::atomic<bool> threadRun_ {};
+	std::atomic<std::chrono::nanoseconds::rep> interval_ {};
 };
 
 //TODO: split off class QueueManager. SubmitManager will only use QueueManager for locking.
@@ -69,20 +254,32 @@ protected:
 
 ///Class that manages all commands submitted to the gpu.
 ///In vulkan, submitting work to the device is a pretty heavy operation and must be synchronized
-///(i.e. there should always only be one thread calling vkQueueSubmit no matter on which queue).
+///per queue (i.e. there must never be two threads calling vkQueueSubmit, vkQueuePresentKHR or
+///vkQueueBindSparse on the same queue at the same time).
 ///This class threadsafely manages this submissions and also batches mulitple command buffers
 ///together which will increase performance.
-///There is always only one SubmitManager for a vulkan device and if vkQueueSumit is called
-///maually, it must be assured that no other thread calls this function or uses the submitManager
-///for the same device at the same moment.
+///Adding submissions is lock-free: every queue has its own multi-producer queue of pooled
+///submission nodes, so threads recording and adding command buffers never block each other.
+///Submitting to a queue only locks this queue, so submissions to different queues
+///(e.g. a compute and a graphics queue) never block each other.
+///There is always only one SubmitManager for a vulkan device and if a queue is used
+///manually, it must be locked using acquire(queue).
 class SubmitManager : public Resource
 {
 public:
+	///Keeps either one or all queues of a device locked as long as it is alive.
 	class Lock : public NonMovable, public Resource
 	{
 	public:
+		///Locks all queues of the given device.
 		Lock(const Device& dev);
+
+		///Locks only the given queue.
+		Lock(const Device& dev, const Queue& queue);
 		~Lock();
+
+	protected:
+		const Queue* queue_ {};
 	};
 
 public:
@@ -95,33 +292,181 @@ public:
 	void submit(vk::Queue queue);
 
 	///Adds a given vulkan submit info for exection of a commandBuffer on the given queue.
-	///Note that this function does NOT directly submits the given info. It will wait until there
-	///are many submissions batched together or a submit member function is called.
+	///Note that this function does NOT directly submits the given info. It will wait until a
+	///submit member function is called or, if the submission thread is running, until the
+	///batch size or latency of the queue is reached.
 	///Note that all pointers in the vk::SubmitInfo must remain valid until the submission
 	///submitted to the gpu.
+	///The given queue must be one of the queues of the device.
 	void add(vk::Queue, const vk::SubmitInfo& info, CommandExecutionState* state = nullptr);
 	void add(vk::Queue, const std::vector<vk::CommandBuffer>& bufs, CommandExecutionState* = nullptr);
 	void add(vk::Queue, vk::CommandBuffer buffer, CommandExecutionState* state = nullptr);
 
-	///Function for ExecutionState
+	///Function for ExecutionState. Submits the queue the given state was added to.
+	///Returns false if the state was already submitted.
 	bool submit(const CommandExecutionState& state);
 
-	///This function must be called before submitting command buffers to the device.
-	///All queues will be acquired as long as the return Lock object is alive.
+	///Submits all queues the given states were added to, if they were not yet submitted.
+	///Every queue is submitted only once, i.e. all its pending submissions are batched
+	///into one vkQueueSubmit call with one shared fence. Invalid states are ignored.
+	void submit(const Range<const CommandExecutionState*>& states);
+
+	///Makes the pending submission of the waiting state wait for the submission of the
+	///signal state at the given pipeline stage.
+	///If both are on different queues, a pooled semaphore is signaled by the one and waited
+	///on by the other one and the queue of the signal state will always be submitted before
+	///the queue of the waiting state. For submissions on the same queue only the submission
+	///order is assured, i.e. the commands must contain the needed pipeline barriers.
+	///Dependencies between two queues must not go in both directions while submissions
+	///are pending on both of them.
+	///Returns false if the signal state was already submitted to another queue and
+	///the caller has to wait for it before submitting the waiting state.
+	///\exception std::logic_error if the waiting state was already submitted, the signal
+	///state was added after it to the same queue or the dependency would be cyclic.
+	bool addDependency(const CommandExecutionState& waiting, const CommandExecutionState& signal,
+		vk::PipelineStageFlags stage);
+
+	///Starts a thread that automatically submits all pending submissions of a queue once
+	///they contain at least batchSize command buffers or the oldest of them was added
+	///more than latency ago. Everything pending for a queue is submitted with one call.
+	///Adding submissions only notifies the thread when a queue gets its first pending
+	///submission or reaches the batch size, it never submits itself.
+	///Waiting for a CommandExecutionState still submits its queue directly from
+	///the waiting thread. If the thread is already running, only changes the thresholds.
+	void startThread(unsigned int batchSize = 16,
+		std::chrono::nanoseconds latency = std::chrono::milliseconds(1));
+
+	///Stops the submission thread if it is running.
+	///Pending submissions remain pending until submitted manually.
+	void stopThread();
+
+	///Returns whether the submission thread is running.
+	bool threaded() const { return threadRun_.load(); }
+
+	///Binds sparse memory on the given queue while it is locked.
+	void bindSparse(const Queue& queue, const Range<vk::BindSparseInfo>& infos,
+		vk::Fence fence = {});
+
+	///Locks the given queue as long as the returned object is alive.
+	///Must be used for every operation that requires external synchronization of the queue
+	///but is not done through this class, e.g. vkQueueSubmit, vkQueuePresentKHR,
+	///vkQueueBindSparse or vkQueueWaitIdle.
+	Lock acquire(const Queue& queue) const;
+
+	///Locks all queues of the device as long as the returned Lock object is alive.
+	///Only needed for operations that require external synchronization of all queues,
+	///which is only vkDeviceWaitIdle (see Device::waitIdle). Blocks all other
+	///queue operations, so should not be used for anything else.
 	Lock acquire() const;
 
 protected:
 	struct Submission;
+	struct QueueSubmissions;
 	friend class Device;
 	friend class Lock;
+	friend class CommandExecutionState;
+	friend class CompletionMonitor;
 
 protected:
 	SubmitManager(const Device& dev);
 	~SubmitManager();
 
+	///Creates the submission queues. Called by the device once its queues were retrieved.
+	void init();
+
+	QueueSubmissions& queueSubmissions(vk::Queue queue);
+	QueueSubmissions& queueSubmissions(const Queue& queue);
+	Submission& allocate();
+	void push(QueueSubmissions& queue, Submission& submission, CommandExecutionState* state);
+	bool flush(QueueSubmissions& queue, const CommandExecutionState* state = nullptr);
+	void restore(QueueSubmissions& queue); //makes the flushed submissions pending again
+
+	///Registers the callback with the pending submission of the given state.
+	///Returns false if the state was already submitted.
+	bool addCallback(const CommandExecutionState& state, CompletionMonitor::Callback& callback);
+	void notifyThread();
+	void threadMain();
+
 protected:
-	std::mutex mutex_;
-	std::unordered_map<vk::Queue, std::vector<Submission>> submissions_;
+	std::vector<std::unique_ptr<QueueSubmissions>> queues_; //not changed after init
+	std::atomic<Submission*> unused_ {}; //stack of unused nodes, only popped as a whole
+
+	std::thread thread_;
+	std::mutex threadMutex_;
+	std::condition_variable threadCV_;
+	std::atomic<bool> threadRun_ {};
+	bool threadNotified_ {}; //whether notified since the last scan, guarded by threadMutex_
+	std::atomic<unsigned int> batchSize_ {};
+	std::atomic<std::chrono::nanoseconds::rep> latency_ {};
 };
 
+///Can be used to track the state of a queued command buffer or to submit it to the device.
+class CommandExecutionState : public Resource
+{
+public:
+	CommandExecutionState() = default;
+	~CommandExecutionState();
+
+	CommandExecutionState(CommandExecutionState&& other) noexcept;
+	CommandExecutionState& operator=(CommandExecutionState&& other) noexcept;
+
+	///Makes sure the commands associated with this control are submitted to the gpu.
+	void submit();
+
+	///Waits for the commands associated with this control to finish.
+	///Will wait at least for the given timeout on nanoseconds.
+	void wait(std::uint64_t timeout = ~std::uint64_t(0));
+
+	///Returns whether the commands were submitted to the gpu.
+	bool submitted() const;
+
+	///Returns whether execution of the associated commands have been finished.
+	///Every queue tracks the id of its last submission known to be completed, so
+	///this only has to query the fence as long as the completion is not known.
+	bool completed() const;
+
+	bool valid() const { return queue_; }
+
+	///Returns the fence that is signaled when the commands completed.
+	///Only valid once the commands were submitted.
+	const FenceRef& fence() const { return fence_; }
+
+protected:
+	friend class SubmitManager;
+	friend bool waitAll(const Range<const CommandExecutionState*>&, std::uint64_t);
+	friend int waitAny(const Range<const CommandExecutionState*>&, std::uint64_t);
+
+	///Associates this state with the given submission which was not yet pushed.
+	void init(const Device& dev, SubmitManager::QueueSubmissions& queue,
+		SubmitManager::Submission& submission);
+
+	///Detaches this state from its submission.
+	void release();
+
+	///Marks the submission of this state (and all earlier ones on its queue) as completed.
+	void markCompleted() const;
+
+protected:
+	FenceRef fence_; //valid once submitted_ is true
+	SubmitManager::QueueSubmissions* queue_ {};
+	SubmitManager::Submission* submission_ {}; //guarded by the mutex of queue_, reset on submit
+	std::uint64_t id_ {}; //id of the submission on its queue, valid once submitted_ is true
+	std::atomic<bool> submitted_ {};
+};
+
+///Waits until all given states are completed using only one vkWaitForFences call.
+///Submits all states that were not yet submitted, every queue only once.
+///All states must belong to the same device. Invalid states are ignored.
+///Returns false if the timeout (in nanoseconds) elapsed before all states completed.
+bool waitAll(const Range<const CommandExecutionState*>& states,
+	std::uint64_t timeout = ~std::uint64_t(0));
+
+///Waits until at least one of the given states is completed using only one vkWaitForFences call.
+///Submits all states that were not yet submitted.
+///All states must belong to the same device. Invalid states are ignored.
+///Returns the index of a completed state or -1 if the timeout (in nanoseconds) elapsed
+///or there are no valid states.
+int waitAny(const Range<const CommandExecutionState*>& states,
+	std::uint64_t timeout = ~std::uint64_t(0));
+
 }
@@ -66,7 +66,7 @@ public:
 		const vk::Extent2D& size) const override;
 };
 
-///TODO: synchronization for acquire and present commands. Handle acquire -> out_of_date
+///TODO: Handle acquire -> out_of_date
 ///Represents Vulkan swap chain and associated images/frameBuffers.
 class SwapChain : public ResourceHandle<vk::SwapchainKHR>
 {
@@ -121,6 +121,7 @@ public:
     vk::Result acquire(unsigned int& id, vk::Semaphore sem = {}, vk::Fence fence = {}) const;
 
 	///Queues commands to present the image with the given id on the given queue.
+	///Only locks the given queue (using SubmitManager::acquire(queue)) while presenting.
 	///\param wait The semaphore to wait on before presenting (usually signaled at the end
 	///of all rendering commands for this image). Can be nullHandle.
 	///\return The result returned by vkQueuePresentKHR. The caller has to handle
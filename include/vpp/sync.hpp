@@ -0,0 +1,149 @@
+#pragma once
+
+#include <vpp/fwd.hpp>
+#include <vpp/vulkan/enums.hpp>
+#include <vpp/vulkan/structs.hpp>
+
+#include <vector>
+#include <unordered_map>
+
+namespace vpp
+{
+
+///Returns the accesses an image in the given layout is (usually) used with.
+///E.g. transferWrite for transferDstOptimal or shaderRead and inputAttachmentRead
+///for shaderReadOnlyOptimal. Returns no access for undefined and presentSrcKHR and
+///memoryRead | memoryWrite for general.
+vk::AccessFlags layoutAccess(vk::ImageLayout layout);
+
+///Returns the write accesses of the given access mask.
+vk::AccessFlags writeAccess(vk::AccessFlags access);
+
+///Returns the pipeline stages in which the given accesses may happen.
+///Only includes stages supported by a queue with the given flags, accesses that cannot
+///be mapped to a supported stage result in allCommands.
+///Returns no stages for no access, the caller has to use topOfPipe (as source stage) or
+///bottomOfPipe (as destination stage) in this case.
+vk::PipelineStageFlags accessStages(vk::AccessFlags access,
+	vk::QueueFlags queueFlags = vk::QueueBits::graphics | vk::QueueBits::compute);
+
+///Remembers the current layout, accesses and pipeline stages of image subresources and
+///buffer ranges used in a command buffer and records the minimal pipeline barriers needed
+///when they are used differently.
+///Each use only queues the needed barrier, all queued barriers are recorded together
+///with a single vkCmdPipelineBarrier call when flush is called, so all resources that will
+///be used by the following commands should be used (declared) before flushing.
+///Reads after reads need no barrier, reads after writes only need one if the write was
+///not already made visible to the reading stages and accesses.
+///Different aspects of an image are tracked together.
+///Is not threadsafe, must be synchronized externally. Every command buffer (or sequence of
+///command buffers submitted in order to the same queue) should use its own tracker.
+class ResourceStateTracker
+{
+public:
+	///The state of a resource (or subresource) after the last recorded command.
+	struct State
+	{
+		vk::ImageLayout layout {};
+		vk::AccessFlags writeAccess {}; //accesses of the last write
+		vk::PipelineStageFlags writeStages {}; //stages of the last write (or layout transition)
+		vk::AccessFlags readAccess {}; //accesses the last write was made visible to
+		vk::PipelineStageFlags readStages {}; //stages that read since the last write
+	};
+
+public:
+	///The queue flags restrict the pipeline stages that are used in the barriers.
+	ResourceStateTracker(vk::QueueFlags queueFlags = vk::QueueBits::graphics | vk::QueueBits::compute);
+
+	///Starts tracking the given image, all subresources have the given layout and are not
+	///used by any pending command.
+	void track(vk::Image image, unsigned int levels, unsigned int layers,
+		vk::ImageAspectFlags aspects = vk::ImageAspectBits::color,
+		vk::ImageLayout layout = vk::ImageLayout::undefined);
+
+	///Starts tracking the given image with the given state for all subresources.
+	///Can be used e.g. to make the first use of an image wait for the given stages of previous
+	///commands (like the commands of a previous frame or using aliased memory).
+	void track(vk::Image image, unsigned int levels, unsigned int layers,
+		vk::ImageAspectFlags aspects, const State& state);
+
+	///Starts tracking the whole given buffer with the given state.
+	///Buffers do not have to be tracked before using them, see use.
+	void track(vk::Buffer buffer, const State& state);
+
+	///Declares that the given subresources will be used by the following commands in the given
+	///layout with the given accesses in the given stages. If the stages are empty, they are
+	///derived from the access.
+	///Queues a barrier (and layout transition) if needed.
+	///\exception std::logic_error if the image is not tracked.
+	void use(vk::Image image, const vk::ImageSubresourceRange& range, vk::ImageLayout layout,
+		vk::AccessFlags access, vk::PipelineStageFlags stages = {});
+
+	///Declares that the given buffer range will be used by the following commands with the
+	///given accesses in the given stages. Buffers do not have to be tracked before.
+	void use(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size,
+		vk::AccessFlags access, vk::PipelineStageFlags stages = {});
+
+	///Records all queued barriers into the given command buffer with one vkCmdPipelineBarrier
+	///call. Does nothing if there are none.
+	///Returns the number of image and buffer barriers that were recorded.
+	unsigned int flush(vk::CommandBuffer cmdBuffer);
+
+	///Returns the current state of the given image subresource.
+	///The state includes queued but not yet flushed barriers.
+	///\exception std::logic_error if the image is not tracked.
+	State state(vk::Image image, unsigned int level, unsigned int layer) const;
+
+	///Stops tracking the given resource.
+	void forget(vk::Image image);
+	void forget(vk::Buffer buffer);
+
+	///Returns whether there are queued barriers.
+	bool pending() const { return pending_; }
+
+protected:
+	struct Pending
+	{
+		bool valid {};
+		vk::ImageLayout layout {};
+		vk::AccessFlags access {};
+		vk::PipelineStageFlags stages {};
+	};
+
+	struct Subresource
+	{
+		State state;
+		Pending pending;
+	};
+
+	struct ImageState
+	{
+		unsigned int levels {};
+		unsigned int layers {};
+		vk::ImageAspectFlags aspects {};
+		std::vector<Subresource> subresources; //levels * layers, level major
+	};
+
+	struct BufferRange
+	{
+		vk::DeviceSize offset {};
+		vk::DeviceSize end {};
+		Subresource state;
+	};
+
+	void use(Subresource& sub, vk::ImageLayout layout, vk::AccessFlags access,
+		vk::PipelineStageFlags stages);
+	void split(std::vector<BufferRange>& ranges, vk::DeviceSize at);
+
+protected:
+	vk::QueueFlags queueFlags_ {};
+	std::unordered_map<vk::Image, ImageState> images_;
+	std::unordered_map<vk::Buffer, std::vector<BufferRange>> buffers_; //sorted, disjoint
+	bool pending_ {};
+
+	//reused for flushing
+	std::vector<vk::ImageMemoryBarrier> imageBarriers_;
+	std::vector<vk::BufferMemoryBarrier> bufferBarriers_;
+};
+
+}
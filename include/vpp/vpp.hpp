@@ -12,20 +12,27 @@
 #include <vpp/commandBuffer.hpp>
 #include <vpp/computePipeline.hpp>
 #include <vpp/context.hpp>
+#include <vpp/convert.hpp>
 #include <vpp/debug.hpp>
 #include <vpp/descriptor.hpp>
 #include <vpp/device.hpp>
 #include <vpp/framebuffer.hpp>
+#include <vpp/frameGraph.hpp>
+#include <vpp/frameTimings.hpp>
 #include <vpp/fwd.hpp>
 #include <vpp/graphicsPipeline.hpp>
 #include <vpp/image.hpp>
 #include <vpp/init.hpp>
+#include <vpp/ktx.hpp>
 #include <vpp/memory.hpp>
 #include <vpp/memoryResource.hpp>
+#include <vpp/offscreenRenderer.hpp>
 #include <vpp/pipeline.hpp>
 #include <vpp/procAddr.hpp>
 #include <vpp/provider.hpp>
 #include <vpp/queue.hpp>
+#include <vpp/readback.hpp>
+#include <vpp/recorder.hpp>
 #include <vpp/renderer.hpp>
 #include <vpp/renderPass.hpp>
 #include <vpp/resource.hpp>
@@ -33,6 +40,7 @@
 #include <vpp/submit.hpp>
 #include <vpp/surface.hpp>
 #include <vpp/swapChain.hpp>
+#include <vpp/sync.hpp>
 #include <vpp/transfer.hpp>
 #include <vpp/vk.hpp>
 #include <vpp/work.hpp>
@@ -26,6 +26,13 @@ public:
 		finished //work was completley finished
 	};
 
+public:
+	///Work objects are allocated from thread local caches of memory blocks, so that the
+	///short-lived works created e.g. for every fill or retrieve call do not cause heap
+	///allocations once the caches are warm. They may be destroyed on any thread.
+	static void* operator new(std::size_t size);
+	static void operator delete(void* ptr, std::size_t size);
+
 public:
 	virtual ~WorkBase() = default;
 
@@ -34,6 +41,32 @@ public:
 	virtual void wait() = 0; //waits until the command buffer is fullly executed
 	virtual void finish() = 0; //will block until the opertion has completed (if it hasnt)
 
+	///Returns the execution state of the gpu commands associated with this work or nullptr
+	///if there are none. Allows to wait for multiple works at once. \sa waitAll
+	virtual const CommandExecutionState* executionState() { return nullptr; }
+
+	///Makes the gpu commands of this work wait at the given pipeline stage until the
+	///commands of the given work were executed. Must be called before this work is submitted.
+	///If both works use different queues, this is done using a semaphore and the submission
+	///of the other work will be done (in one batch) before the submission of this work.
+	///If both use the same queue, only the submission order is assured and the commands
+	///must contain the needed pipeline barriers themselves.
+	///If the other work was already submitted to another queue or has no execution state,
+	///this function waits for it to be executed.
+	///\exception std::logic_error if this work has no execution state or was already submitted.
+	///\sa SubmitManager::addDependency
+	void after(WorkBase& other, vk::PipelineStageFlags stage);
+
+	///Runs the given callback once the gpu has executed the commands of this work.
+	///Does not submit the work. The callback is run by the completion monitor of the
+	///device, i.e. on the next Device::pollCompletions call, by the monitor thread or by
+	///the executor of the monitor. Note that the work is only executed and not finished
+	///at that point, the callback may call finish on it without blocking though, if it
+	///is still alive.
+	///If the work has no execution state, waits for it and calls the callback directly.
+	///\sa CompletionMonitor
+	void then(std::function<void()> callback);
+
 	bool pending() { return state() == State::pending; }
 	bool submitted() { return static_cast<unsigned int>(state()) > 1; }
 	bool executed() { return static_cast<unsigned int>(state()) > 2; }
@@ -81,11 +114,13 @@ class CommandWork : public Work<R>
 public:
 	CommandWork() = default;
 	CommandWork(CommandBuffer&& buffer, vk::Queue queue);
+	~CommandWork();
 
 	virtual void submit() override;
 	virtual void finish() override;
 	virtual void wait() override;
 	virtual WorkBase::State state() override;
+	virtual const CommandExecutionState* executionState() override { return &executionState_; }
 
 public:
 	CommandBuffer cmdBuffer_;
@@ -93,9 +128,27 @@ public:
 	WorkBase::State state_ {WorkBase::State::none};
 };
 
+///Waits until the gpu has executed all given works. Submits the works that were not yet
+///submitted and waits for all of them with one vkWaitForFences call. Works that have no
+///execution state are waited for one by one, without timeout.
+///All works must belong to the same device.
+///Returns false if the timeout (in nanoseconds) elapsed before all works were executed.
+bool waitAll(const Range<WorkBase*>& works, std::uint64_t timeout = ~std::uint64_t(0));
+
+///Waits until the gpu has executed at least one of the given works using only one
+///vkWaitForFences call. Submits the works that were not yet submitted.
+///If none of the works has an execution state, waits for the first one not executed.
+///All works must belong to the same device.
+///Returns the index of an executed work or -1 if the timeout (in nanoseconds) elapsed or
+///the given range is empty.
+int waitAny(const Range<WorkBase*>& works, std::uint64_t timeout = ~std::uint64_t(0));
+
 ///Manages (i.e. submits and waits) for multiple work objects.
 ///On desctruction this call will automatically finish all owned work objects.
-///The work objects are always finished in the same order that they were added.
+///Submitting gathers the pending command buffers of all works and submits them with only
+///one vkQueueSubmit call (and one shared fence) per queue.
+///The work objects are always finished in the same order that they were added, after
+///waiting for all of them at once.
 ///Can be really useful when postponing multiple work batches together and not expliclity
 ///finish them until end of initialization which can result in better performance.
 class WorkManager
@@ -9,6 +9,17 @@
 namespace vpp
 {
 
+namespace
+{
+
+//The vectors of the last finished BufferUpdate on this thread are reused to avoid
+//allocations for every update.
+thread_local std::vector<std::uint8_t> cachedUpdateData;
+thread_local std::vector<vk::BufferCopy> cachedUpdateCopies;
+constexpr auto maxCachedUpdateData = 65536u;
+
+}
+
 DataWorkPtr retrieve(const Buffer& buf, vk::DeviceSize offset, vk::DeviceSize size)
 {
 	VPP_DEBUG_CHECK(vpp::retrive(buffer),
@@ -36,7 +47,7 @@ DataWorkPtr retrieve(const Buffer& buf, vk::DeviceSize offset, vk::DeviceSize si
 		auto cmdBuffer = buf.device().commandProvider().get(qFam);
 		auto downloadBuffer = buf.device().transferManager().buffer(size);
 
-		vk::BufferCopy region {offset, 0, size};
+		vk::BufferCopy region {offset, downloadBuffer.offset(), size};
 
 		vk::beginCommandBuffer(cmdBuffer, {});
 		vk::cmdCopyBuffer(cmdBuffer, buf, downloadBuffer.buffer(), {region});
@@ -62,10 +73,12 @@ BufferUpdate::BufferUpdate(const Buffer& buffer, BufferLayout align, bool direct
 		const Queue* queue;
 		auto qFam = transferQueueFamily(device(), &queue);
 		auto cmdBuffer = device().commandProvider().get(qFam);
+		copies_.swap(cachedUpdateCopies);
 		copies_.push_back({0, 0, 0});
 
 		if(direct)
 		{
+			data_.swap(cachedUpdateData);
 			data_.resize(buffer.size());
 			direct_ = true;
 			work_ = std::make_unique<CommandWork<void>>(std::move(cmdBuffer), *queue);
@@ -158,23 +171,29 @@ std::uint8_t& BufferUpdate::data()
 
 WorkPtr BufferUpdate::apply()
 {
+	if(!work_) return {};
 	if(!direct_ && !map_.coherent()) map_.flush();
 
-	auto uploadWork = dynamic_cast<UploadWork*>(work_.get()); //transfer
-	auto commandWork = dynamic_cast<CommandWork<void>*>(work_.get()); //direct
-	if(uploadWork)
+	//the type of work was chosen in the constructor
+	if(buffer().mappable())
 	{
-		auto& cmdBuf = uploadWork->cmdBuffer_;
-		auto& transferRange = uploadWork->transferRange_;
+		//FinishedWork, nothing to record
+	}
+	else if(!direct_)
+	{
+		auto& uploadWork = static_cast<UploadWork&>(*work_); //transfer
+		auto& cmdBuf = uploadWork.cmdBuffer_;
+		auto& transferRange = uploadWork.transferRange_;
 
 		vk::beginCommandBuffer(cmdBuf, {});
 		for(auto& update : copies_)
 			vk::cmdCopyBuffer(cmdBuf, transferRange.buffer(), buffer(), {update});
 		vk::endCommandBuffer(cmdBuf);
 	}
-	else if(commandWork)
+	else
 	{
-		auto& cmdBuf = commandWork->cmdBuffer_;
+		auto& commandWork = static_cast<CommandWork<void>&>(*work_); //direct
+		auto& cmdBuf = commandWork.cmdBuffer_;
 
 		vk::beginCommandBuffer(cmdBuf, {});
 		for(auto& upd : copies_)
@@ -182,6 +201,13 @@ WorkPtr BufferUpdate::apply()
 		vk::endCommandBuffer(cmdBuf);
 	}
 
+	//keep the memory of the vectors for the next update, only small data is cached
+	data_.clear();
+	copies_.clear();
+	if(data_.capacity() > cachedUpdateData.capacity() && data_.capacity() <= maxCachedUpdateData)
+		data_.swap(cachedUpdateData);
+	if(copies_.capacity() > cachedUpdateCopies.capacity()) copies_.swap(cachedUpdateCopies);
+
 	data_ = {};
 	map_ = {};
 	copies_ = {};
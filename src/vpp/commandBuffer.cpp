@@ -1,74 +1,169 @@
 #include <vpp/commandBuffer.hpp>
+#include <vpp/submit.hpp>
 #include <vpp/vk.hpp>
+#include <vpp/utility/debug.hpp>
+#include <vpp/recycler.hpp>
 
 namespace vpp
 {
 
 //CommandBuffer
-CommandBuffer::CommandBuffer(vk::CommandBuffer buffer, const CommandPool& pool)
-	: ResourceHandleReference(buffer), commandPool_(&pool)
+CommandBuffer::CommandBuffer(vk::CommandBuffer buffer, const CommandPool& pool,
+	vk::CommandBufferLevel lvl) : ResourceHandleReference(buffer), commandPool_(&pool), level_(lvl)
 {
 }
 
 CommandBuffer::~CommandBuffer()
 {
-	if(vkHandle())
-	{
-		//TODO. cannot always be done
-		//vk::freeCommandBuffers(vkDevice(), commandPool().vkCommandPool(), {commandBuffer_});
-	}
+	if(vkHandle() && commandPool_) commandPool_->release(vkHandle(), level_, nullptr);
+}
+
+void swap(CommandBuffer& a, CommandBuffer& b) noexcept
+{
+	using std::swap;
+
+	swap(a.resourceBase(), b.resourceBase());
+	swap(a.commandPool_, b.commandPool_);
+	swap(a.level_, b.level_);
 }
 
 //CommandPool
+struct CommandPool::Recycler : public vpp::Recycler<vk::CommandBuffer, FenceRef>
+{
+};
+
 CommandPool::CommandPool(const Device& dev, std::uint32_t qfam, vk::CommandPoolCreateFlags flags)
-	: ResourceHandle(dev)
+	: ResourceHandle(dev), flags_(flags), qFamily_(qfam)
 {
 	vk::CommandPoolCreateInfo info;
 	info.flags = flags;
 	info.queueFamilyIndex = qfam;
 
 	vkHandle() = vk::createCommandPool(device(), info);
+	recycler_ = std::make_unique<Recycler>();
 }
+
 CommandPool::~CommandPool()
 {
+	//destroying the pool frees all command buffers, including the recycled ones
 	if(vkHandle()) vk::destroyCommandPool(vkDevice(), vkHandle(), nullptr);
 }
 
+CommandPool::CommandPool(CommandPool&& other) noexcept = default;
+CommandPool& CommandPool::operator=(CommandPool&& other) noexcept = default;
+
 std::vector<CommandBuffer> CommandPool::allocate(std::size_t count, vk::CommandBufferLevel lvl)
 {
+	std::vector<CommandBuffer> ret;
+	ret.reserve(count);
+
+	while(ret.size() < count)
+	{
+		auto buffer = reuse(lvl);
+		if(!buffer) break;
+		ret.emplace_back(buffer, *this, lvl);
+	}
+
+	if(ret.size() == count) return ret;
+
 	vk::CommandBufferAllocateInfo info;
 	info.commandPool = vkHandle();
 	info.level = lvl;
-	info.commandBufferCount = count;
+	info.commandBufferCount = count - ret.size();
 
-	std::vector<vk::CommandBuffer> buffers(count);
+	std::vector<vk::CommandBuffer> buffers(info.commandBufferCount);
 	vk::allocateCommandBuffers(device(), info, *buffers.data());
-
-	std::vector<CommandBuffer> ret;
-	ret.reserve(count);
+	allocated_ += buffers.size();
 
 	for(auto& buf : buffers)
-		ret.emplace_back(buf, *this);
+		ret.emplace_back(buf, *this, lvl);
 
 	return ret;
 }
 
 CommandBuffer CommandPool::allocate(vk::CommandBufferLevel lvl)
 {
+	auto buffer = reuse(lvl);
+	if(buffer) return {buffer, *this, lvl};
+
 	vk::CommandBufferAllocateInfo info;
 	info.commandPool = vkHandle();
 	info.level = lvl;
 	info.commandBufferCount = 1;
 
-	vk::CommandBuffer buffer;
 	vk::allocateCommandBuffers(vkDevice(), info, buffer);
+	++allocated_;
 
-	return {buffer, *this};
+	return {buffer, *this, lvl};
+}
+
+void CommandPool::recycle(CommandBuffer&& buffer, const FenceRef& fence) const
+{
+	if(!buffer.vkHandle()) return;
+
+	VPP_DEBUG_CHECK(vpp::CommandPool::recycle,
+	{
+		if(buffer.commandPool_ != this) VPP_DEBUG_OUTPUT("Buffer was not allocated from this pool");
+	})
+
+	release(buffer.vkHandle(), buffer.level_, &fence);
+	buffer.vkHandle() = {};
+}
+
+void CommandPool::release(vk::CommandBuffer buffer, vk::CommandBufferLevel lvl,
+	const FenceRef* fence) const
+{
+	if(!recycler_) return;
+
+	//without a fence it is unknown whether the buffer is still pending, so it is only
+	//reused once the pool is known to be idle
+	auto kind = static_cast<unsigned int>(lvl);
+	if(fence) recycler_->release(buffer, kind, *fence);
+	else recycler_->defer(buffer, kind, device().idleCount());
+}
+
+void CommandPool::idle() const
+{
+	if(recycler_) recycler_->idle();
+}
+
+void CommandPool::freeRecycled()
+{
+	if(!recycler_) return;
+	recycler_->clear([&](vk::CommandBuffer buffer) {
+		vk::freeCommandBuffers(vkDevice(), vkHandle(), 1, buffer);
+	});
+}
+
+vk::CommandBuffer CommandPool::reuse(vk::CommandBufferLevel lvl)
+{
+	if(!recycler_) return {};
+
+	//without the flag, command buffers can not be reset individually, so all
+	//buffers that are no longer pending are freed instead
+	bool resettable = (flags_ & vk::CommandPoolCreateBits::resetCommandBuffer);
+	auto kind = resettable ? static_cast<unsigned int>(lvl) : ~0u;
+
+	auto signaled = [&](const FenceRef& fence) {
+		return vk::getFenceStatus(vkDevice(), fence) == vk::Result::success; };
+	auto discard = [&](vk::CommandBuffer buffer) {
+		vk::freeCommandBuffers(vkDevice(), vkHandle(), 1, buffer); };
+
+	auto ret = recycler_->take(kind, device().idleCount(), signaled, !resettable, discard);
+	if(ret)
+	{
+		vk::resetCommandBuffer(ret, {});
+		++reused_;
+	}
+
+	return ret;
 }
 
 void CommandPool::reset(vk::CommandPoolResetFlags flags) const
 {
+	//resetting requires that no command buffer of the pool is pending
 	vk::resetCommandPool(device(), vkHandle(), flags);
+	idle();
 }
 
 //CommandProvider
@@ -79,6 +174,8 @@ CommandProvider::CommandProvider(const Device& dev) : Resource(dev)
 CommandBuffer CommandProvider::get(std::uint32_t family,
  	vk::CommandPoolCreateFlags flags, vk::CommandBufferLevel lvl)
 {
+	flags |= vk::CommandPoolCreateBits::resetCommandBuffer;
+
 	auto& pools = device().tlCommandPools();
 	for(auto& pool : pools)
 	{
@@ -88,14 +185,16 @@ CommandBuffer CommandProvider::get(std::uint32_t family,
 		}
 	}
 
-	 pools.emplace_back(device(), family, flags);
-	 return pools.back().allocate(lvl);
+	pools.emplace_back(device(), family, flags);
+	return pools.back().allocate(lvl);
 }
 
 
 std::vector<CommandBuffer> CommandProvider::get(std::uint32_t family, unsigned int count,
 	vk::CommandPoolCreateFlags flags, vk::CommandBufferLevel lvl)
 {
+	flags |= vk::CommandPoolCreateBits::resetCommandBuffer;
+
 	auto& pools = device().tlCommandPools();
 	for(auto& pool : pools)
 	{
@@ -105,8 +204,8 @@ std::vector<CommandBuffer> CommandProvider::get(std::uint32_t family, unsigned i
 		}
 	}
 
-	 pools.emplace_back(device(), family, flags);
-	 return pools.back().allocate(count, lvl);
+	pools.emplace_back(device(), family, flags);
+	return pools.back().allocate(count, lvl);
 }
 
 }
@@ -57,7 +57,7 @@ void Context::initInstance(const CreateInfo& info)
 
 	//iniinfo
 	std::vector<const char*> extensions = info.instanceExtensions;
-	extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+	if(!info.headless) extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
 
 	if(info.debugFlags != 0)
 	{
@@ -82,8 +82,18 @@ void Context::initInstance(const CreateInfo& info)
 
 vk::PhysicalDevice Context::choosePhysicalDevice(const std::vector<vk::PhysicalDevice>& phdevs) const
 {
+	static const auto bothFlags = vk::QueueBits::graphics | vk::QueueBits::compute;
+
 	for(auto& phdev : phdevs)
 	{
+		if(headless())
+		{
+			for(auto& qProp : vk::getPhysicalDeviceQueueFamilyProperties(phdev))
+				if((qProp.queueFlags & bothFlags) == bothFlags) return phdev;
+
+			continue;
+		}
+
 		auto queues = surface().supportedQueueFamilies(phdev);
 		if(!queues.empty())
 		{
@@ -104,7 +114,7 @@ void Context::initDevice(const CreateInfo& info)
 	//atm: activate all layes - make this configurable maybe?
 	//or at least query the layers and not use the hard coded names?
 	std::vector<const char*> extensions = info.deviceExtensions;
-	extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	if(!headless()) extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
 	std::vector<const char*> layers;
 	if(info.debugFlags != 0) layers = validationLayerNames;
@@ -112,9 +122,6 @@ void Context::initDevice(const CreateInfo& info)
 	//queues
 	auto queueProps = vk::getPhysicalDeviceQueueFamilyProperties(phdev);
 
-	//present queue
-	auto queues = surface().supportedQueueFamilies(phdev);
-
 	std::uint32_t presentQFam = -1;
 	std::uint32_t graphicsComputeQFam = -1;
 
@@ -123,7 +130,16 @@ void Context::initDevice(const CreateInfo& info)
 	for(auto i = 0u; i < queueProps.size(); ++i)
 	{
 		const auto& qProp = queueProps[i];
-		if(surface().queueFamilySupported(phdev, i))
+		if(headless())
+		{
+			//without surface the graphics and compute queue is also used as present queue
+			if((qProp.queueFlags & bothFlags) == bothFlags)
+			{
+				presentQFam = graphicsComputeQFam = i;
+				break;
+			}
+		}
+		else if(surface().queueFamilySupported(phdev, i))
 		{
 			presentQFam = i;
 			if((qProp.queueFlags & bothFlags) == bothFlags)
@@ -178,6 +194,9 @@ void Context::initDevice(const CreateInfo& info)
 
 void Context::initSwapChain(const CreateInfo& info)
 {
+	if(headless())
+		throw std::logic_error("vpp::Context::initSwapChain: headless context has no surface");
+
 	swapChain_ = SwapChain(device(), surface(), {info.width, info.height});
 }
 
@@ -186,4 +205,15 @@ const vk::Device& Context::vkDevice() const
 	return device().vkDevice();
 }
 
+Context createHeadlessContext(Context::CreateInfo info)
+{
+	info.headless = true;
+
+	Context ret;
+	ret.initInstance(info);
+	ret.initDevice(info);
+
+	return ret;
+}
+
 }
@@ -0,0 +1,505 @@
+#include <vpp/convert.hpp>
+
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define VPP_CONVERT_SSE2
+	#include <emmintrin.h>
+#endif
+
+#if defined(__SSSE3__) || defined(__AVX__)
+	#define VPP_CONVERT_SSSE3
+	#include <tmmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+	#define VPP_CONVERT_AVX2
+	#include <immintrin.h>
+#endif
+
+#if defined(__F16C__)
+	#define VPP_CONVERT_F16C
+	#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#define VPP_CONVERT_NEON
+	#include <arm_neon.h>
+
+	//the float kernels require rounding conversions only available on aarch64
+	#if defined(__aarch64__)
+		#define VPP_CONVERT_NEON64
+	#endif
+#endif
+
+namespace vpp
+{
+
+//utility
+namespace
+{
+
+///The memory layout of a format relevant for conversion.
+enum class TexelLayout
+{
+	unknown,
+	rgb8,
+	bgr8,
+	rgba8,
+	bgra8,
+	rgba16,
+	rgba16f,
+	rgb32f,
+	rgba32f
+};
+
+TexelLayout texelLayout(vk::Format format)
+{
+	using vk::Format;
+
+	switch(format)
+	{
+		case Format::r8g8b8Unorm:
+		case Format::r8g8b8Snorm:
+		case Format::r8g8b8Uscaled:
+		case Format::r8g8b8Sscaled:
+		case Format::r8g8b8Uint:
+		case Format::r8g8b8Sint:
+		case Format::r8g8b8Srgb:
+			return TexelLayout::rgb8;
+
+		case Format::b8g8r8Unorm:
+		case Format::b8g8r8Snorm:
+		case Format::b8g8r8Uscaled:
+		case Format::b8g8r8Sscaled:
+		case Format::b8g8r8Uint:
+		case Format::b8g8r8Sint:
+		case Format::b8g8r8Srgb:
+			return TexelLayout::bgr8;
+
+		//the packed abgr formats have the same memory layout on little endian machines
+		case Format::r8g8b8a8Unorm:
+		case Format::r8g8b8a8Snorm:
+		case Format::r8g8b8a8Uscaled:
+		case Format::r8g8b8a8Sscaled:
+		case Format::r8g8b8a8Uint:
+		case Format::r8g8b8a8Sint:
+		case Format::r8g8b8a8Srgb:
+		case Format::a8b8g8r8UnormPack32:
+		case Format::a8b8g8r8SnormPack32:
+		case Format::a8b8g8r8UscaledPack32:
+		case Format::a8b8g8r8SscaledPack32:
+		case Format::a8b8g8r8UintPack32:
+		case Format::a8b8g8r8SintPack32:
+		case Format::a8b8g8r8SrgbPack32:
+			return TexelLayout::rgba8;
+
+		case Format::b8g8r8a8Unorm:
+		case Format::b8g8r8a8Snorm:
+		case Format::b8g8r8a8Uscaled:
+		case Format::b8g8r8a8Sscaled:
+		case Format::b8g8r8a8Uint:
+		case Format::b8g8r8a8Sint:
+		case Format::b8g8r8a8Srgb:
+			return TexelLayout::bgra8;
+
+		case Format::r16g16b16a16Unorm: return TexelLayout::rgba16;
+		case Format::r16g16b16a16Sfloat: return TexelLayout::rgba16f;
+		case Format::r32g32b32Sfloat: return TexelLayout::rgb32f;
+		case Format::r32g32b32a32Sfloat: return TexelLayout::rgba32f;
+
+		default: return TexelLayout::unknown;
+	}
+}
+
+unsigned int texelSize(TexelLayout layout)
+{
+	switch(layout)
+	{
+		case TexelLayout::rgb8: case TexelLayout::bgr8: return 3;
+		case TexelLayout::rgba8: case TexelLayout::bgra8: return 4;
+		case TexelLayout::rgba16: case TexelLayout::rgba16f: return 8;
+		case TexelLayout::rgb32f: return 12;
+		case TexelLayout::rgba32f: return 16;
+		default: return 0;
+	}
+}
+
+//scalar conversions of single values. The simd kernels must give exactly the same results.
+std::uint8_t unorm16To8(std::uint16_t val)
+{
+	return (val - (val >> 8) + 128) >> 8;
+}
+
+std::uint8_t floatToUnorm8(float val)
+{
+	//same semantics as the sse min/max instructions (nan results in 1)
+	val = (val < 1.f) ? val : 1.f;
+	val = (val > 0.f) ? val : 0.f;
+	return static_cast<std::uint8_t>(std::nearbyint(val * 255.f));
+}
+
+std::uint16_t floatToHalf(float val)
+{
+	std::uint32_t bits;
+	std::memcpy(&bits, &val, sizeof(bits));
+
+	const std::uint32_t sign = (bits >> 16) & 0x8000u;
+	const std::uint32_t abs = bits & 0x7FFFFFFFu;
+
+	//inf and nan (quieted, truncated payload)
+	if(abs >= 0x7F800000u)
+		return sign | 0x7C00u | ((abs > 0x7F800000u) ? (0x200u | ((abs >> 13) & 0x3FFu)) : 0u);
+
+	//values rounding to inf
+	if(abs >= 0x477FF000u) return sign | 0x7C00u;
+
+	//subnormal half values
+	if(abs < 0x38800000u)
+	{
+		if(abs <= 0x33000000u) return sign;
+
+		const std::uint32_t mant = (abs & 0x7FFFFFu) | 0x800000u;
+		const std::uint32_t shift = 126u - (abs >> 23);
+		const std::uint32_t rem = mant & ((1u << shift) - 1u);
+		const std::uint32_t half = 1u << (shift - 1u);
+
+		std::uint32_t ret = mant >> shift;
+		if(rem > half || (rem == half && (ret & 1u))) ++ret;
+		return sign | ret;
+	}
+
+	//normal values, rebias exponent and round to nearest even
+	std::uint32_t ret = (abs - 0x38000000u) >> 13;
+	const std::uint32_t rem = abs & 0x1FFFu;
+	if(rem > 0x1000u || (rem == 0x1000u && (ret & 1u))) ++ret;
+	return sign | ret;
+}
+
+//kernels
+//every kernel converts count texels. The simd versions process as many texels as possible
+//and then let the scalar part convert the rest.
+
+//rgb -> rgba, bgr -> bgra (swap = false) or rgb -> bgra, bgr -> rgba (swap = true)
+void expand8(const std::uint8_t* src, std::uint8_t* dst, std::size_t count, bool swap)
+{
+	std::size_t i = 0u;
+	const unsigned int r = swap ? 2 : 0;
+	const unsigned int b = swap ? 0 : 2;
+
+#if defined(VPP_CONVERT_NEON)
+	for(; i + 16 <= count; i += 16)
+	{
+		auto in = vld3q_u8(src + i * 3);
+		uint8x16x4_t out;
+		out.val[0] = in.val[r];
+		out.val[1] = in.val[1];
+		out.val[2] = in.val[b];
+		out.val[3] = vdupq_n_u8(0xFF);
+		vst4q_u8(dst + i * 4, out);
+	}
+#elif defined(VPP_CONVERT_SSSE3)
+	const auto mask = swap ?
+		_mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+		_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const auto alpha = _mm_set1_epi32(0xFF000000);
+
+	#if defined(VPP_CONVERT_AVX2)
+		const auto mask2 = _mm256_broadcastsi128_si256(mask);
+		const auto alpha2 = _mm256_set1_epi32(0xFF000000);
+
+		//the second load reads 4 bytes (1 texel) further than the 8 converted texels
+		for(; i + 10 <= count; i += 8)
+		{
+			auto lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+			auto hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3 + 12));
+			auto in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+			auto out = _mm256_or_si256(_mm256_shuffle_epi8(in, mask2), alpha2);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), out);
+		}
+	#endif
+
+	//the load reads 4 bytes further than the 4 converted texels
+	for(; i + 6 <= count; i += 4)
+	{
+		auto in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+		auto out = _mm_or_si128(_mm_shuffle_epi8(in, mask), alpha);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), out);
+	}
+#endif
+
+	for(; i < count; ++i)
+	{
+		dst[i * 4 + 0] = src[i * 3 + r];
+		dst[i * 4 + 1] = src[i * 3 + 1];
+		dst[i * 4 + 2] = src[i * 3 + b];
+		dst[i * 4 + 3] = 0xFF;
+	}
+}
+
+//rgba -> bgra, bgra -> rgba
+void swizzle8(const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+	std::size_t i = 0u;
+
+#if defined(VPP_CONVERT_NEON)
+	for(; i + 16 <= count; i += 16)
+	{
+		auto in = vld4q_u8(src + i * 4);
+		auto tmp = in.val[0];
+		in.val[0] = in.val[2];
+		in.val[2] = tmp;
+		vst4q_u8(dst + i * 4, in);
+	}
+#elif defined(VPP_CONVERT_SSE2)
+	#if defined(VPP_CONVERT_AVX2)
+		const auto ga2 = _mm256_set1_epi32(0xFF00FF00);
+		for(; i + 8 <= count; i += 8)
+		{
+			auto in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+			auto rb = _mm256_andnot_si256(ga2, in);
+			rb = _mm256_or_si256(_mm256_slli_epi32(rb, 16), _mm256_srli_epi32(rb, 16));
+			auto out = _mm256_or_si256(_mm256_and_si256(ga2, in), rb);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), out);
+		}
+	#endif
+
+	const auto ga = _mm_set1_epi32(0xFF00FF00);
+	for(; i + 4 <= count; i += 4)
+	{
+		auto in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+		auto rb = _mm_andnot_si128(ga, in);
+		rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+		auto out = _mm_or_si128(_mm_and_si128(ga, in), rb);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), out);
+	}
+#endif
+
+	for(; i < count; ++i)
+	{
+		dst[i * 4 + 0] = src[i * 4 + 2];
+		dst[i * 4 + 1] = src[i * 4 + 1];
+		dst[i * 4 + 2] = src[i * 4 + 0];
+		dst[i * 4 + 3] = src[i * 4 + 3];
+	}
+}
+
+//unorm16 -> unorm8 for count values (not texels)
+void pack16(const std::uint16_t* src, std::uint8_t* dst, std::size_t count)
+{
+	std::size_t i = 0u;
+
+#if defined(VPP_CONVERT_NEON)
+	const auto round = vdupq_n_u16(128);
+	for(; i + 8 <= count; i += 8)
+	{
+		auto in = vld1q_u16(src + i);
+		auto val = vaddq_u16(vsubq_u16(in, vshrq_n_u16(in, 8)), round);
+		vst1_u8(dst + i, vshrn_n_u16(val, 8));
+	}
+#elif defined(VPP_CONVERT_SSE2)
+	#if defined(VPP_CONVERT_AVX2)
+		const auto round2 = _mm256_set1_epi16(128);
+		for(; i + 32 <= count; i += 32)
+		{
+			auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+			auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16));
+			a = _mm256_add_epi16(_mm256_sub_epi16(a, _mm256_srli_epi16(a, 8)), round2);
+			b = _mm256_add_epi16(_mm256_sub_epi16(b, _mm256_srli_epi16(b, 8)), round2);
+			auto out = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+			out = _mm256_permute4x64_epi64(out, 0xD8); //packus works per 128 bit lane
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), out);
+		}
+	#endif
+
+	const auto round = _mm_set1_epi16(128);
+	for(; i + 16 <= count; i += 16)
+	{
+		auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+		a = _mm_add_epi16(_mm_sub_epi16(a, _mm_srli_epi16(a, 8)), round);
+		b = _mm_add_epi16(_mm_sub_epi16(b, _mm_srli_epi16(b, 8)), round);
+		auto out = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), out);
+	}
+#endif
+
+	for(; i < count; ++i) dst[i] = unorm16To8(src[i]);
+}
+
+//float -> unorm8 for count values (not texels)
+void packUnorm8(const float* src, std::uint8_t* dst, std::size_t count)
+{
+	std::size_t i = 0u;
+
+#if defined(VPP_CONVERT_NEON64)
+	const auto one = vdupq_n_f32(1.f);
+	const auto zero = vdupq_n_f32(0.f);
+	const auto scale = vdupq_n_f32(255.f);
+	auto convert = [&](const float* ptr) {
+		auto val = vld1q_f32(ptr);
+		val = vbslq_f32(vcltq_f32(val, one), val, one);
+		val = vbslq_f32(vcgtq_f32(val, zero), val, zero);
+		return vmovn_u32(vcvtnq_u32_f32(vmulq_f32(val, scale)));
+	};
+
+	for(; i + 8 <= count; i += 8)
+		vst1_u8(dst + i, vmovn_u16(vcombine_u16(convert(src + i), convert(src + i + 4))));
+#elif defined(VPP_CONVERT_SSE2)
+	#if defined(VPP_CONVERT_AVX2)
+		const auto one2 = _mm256_set1_ps(1.f);
+		const auto zero2 = _mm256_setzero_ps();
+		const auto scale2 = _mm256_set1_ps(255.f);
+		const auto order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+		auto convert2 = [&](const float* ptr) {
+			auto val = _mm256_min_ps(_mm256_loadu_ps(ptr), one2);
+			val = _mm256_max_ps(val, zero2);
+			return _mm256_cvtps_epi32(_mm256_mul_ps(val, scale2));
+		};
+
+		for(; i + 32 <= count; i += 32)
+		{
+			auto ab = _mm256_packs_epi32(convert2(src + i), convert2(src + i + 8));
+			auto cd = _mm256_packs_epi32(convert2(src + i + 16), convert2(src + i + 24));
+			auto out = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(ab, cd), order);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), out);
+		}
+	#endif
+
+	const auto one = _mm_set1_ps(1.f);
+	const auto zero = _mm_setzero_ps();
+	const auto scale = _mm_set1_ps(255.f);
+	auto convert = [&](const float* ptr) {
+		auto val = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(ptr), one), zero);
+		return _mm_cvtps_epi32(_mm_mul_ps(val, scale));
+	};
+
+	for(; i + 16 <= count; i += 16)
+	{
+		auto ab = _mm_packs_epi32(convert(src + i), convert(src + i + 4));
+		auto cd = _mm_packs_epi32(convert(src + i + 8), convert(src + i + 12));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(ab, cd));
+	}
+#endif
+
+	for(; i < count; ++i) dst[i] = floatToUnorm8(src[i]);
+}
+
+//float -> half for count values (not texels)
+void packHalf(const float* src, std::uint16_t* dst, std::size_t count)
+{
+	std::size_t i = 0u;
+
+#if defined(VPP_CONVERT_NEON64)
+	for(; i + 4 <= count; i += 4)
+		vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+#elif defined(VPP_CONVERT_F16C)
+	for(; i + 8 <= count; i += 8)
+	{
+		auto out = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), out);
+	}
+#endif
+
+	for(; i < count; ++i) dst[i] = floatToHalf(src[i]);
+}
+
+//rgb float -> rgba half
+void expandHalf(const float* src, std::uint16_t* dst, std::size_t count)
+{
+	constexpr std::uint16_t oneHalf = 0x3C00u;
+	std::size_t i = 0u;
+
+#if defined(VPP_CONVERT_NEON64)
+	for(; i + 4 <= count; i += 4)
+	{
+		auto in = vld3q_f32(src + i * 3);
+		uint16x4x4_t out;
+		out.val[0] = vreinterpret_u16_f16(vcvt_f16_f32(in.val[0]));
+		out.val[1] = vreinterpret_u16_f16(vcvt_f16_f32(in.val[1]));
+		out.val[2] = vreinterpret_u16_f16(vcvt_f16_f32(in.val[2]));
+		out.val[3] = vdup_n_u16(oneHalf);
+		vst4_u16(dst + i * 4, out);
+	}
+#elif defined(VPP_CONVERT_F16C)
+	for(; i + 2 <= count; i += 2)
+	{
+		auto p = src + i * 3;
+		auto in = _mm256_setr_ps(p[0], p[1], p[2], 1.f, p[3], p[4], p[5], 1.f);
+		auto out = _mm256_cvtps_ph(in, _MM_FROUND_TO_NEAREST_INT);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), out);
+	}
+#endif
+
+	for(; i < count; ++i)
+	{
+		dst[i * 4 + 0] = floatToHalf(src[i * 3 + 0]);
+		dst[i * 4 + 1] = floatToHalf(src[i * 3 + 1]);
+		dst[i * 4 + 2] = floatToHalf(src[i * 3 + 2]);
+		dst[i * 4 + 3] = oneHalf;
+	}
+}
+
+}
+
+bool texelConvertible(vk::Format srcFormat, vk::Format dstFormat)
+{
+	auto src = texelLayout(srcFormat);
+	auto dst = texelLayout(dstFormat);
+
+	using L = TexelLayout;
+	if(src == L::unknown || dst == L::unknown) return false;
+	if(src == dst) return true;
+
+	switch(src)
+	{
+		case L::rgb8: case L::bgr8: return dst == L::rgba8 || dst == L::bgra8;
+		case L::rgba8: return dst == L::bgra8;
+		case L::bgra8: return dst == L::rgba8;
+		case L::rgba16: return dst == L::rgba8;
+		case L::rgb32f: return dst == L::rgba16f;
+		case L::rgba32f: return dst == L::rgba16f || dst == L::rgba8;
+		default: return false;
+	}
+}
+
+void convertTexels(const std::uint8_t& srcData, vk::Format srcFormat, std::uint8_t& dstData,
+	vk::Format dstFormat, std::size_t count)
+{
+	auto src = texelLayout(srcFormat);
+	auto dst = texelLayout(dstFormat);
+	auto srcPtr = &srcData;
+	auto dstPtr = &dstData;
+
+	using L = TexelLayout;
+	if(src != L::unknown && src == dst)
+	{
+		std::memcpy(dstPtr, srcPtr, count * texelSize(src));
+		return;
+	}
+
+	auto src16 = reinterpret_cast<const std::uint16_t*>(srcPtr);
+	auto srcFloat = reinterpret_cast<const float*>(srcPtr);
+	auto dst16 = reinterpret_cast<std::uint16_t*>(dstPtr);
+
+	if((src == L::rgb8 && dst == L::rgba8) || (src == L::bgr8 && dst == L::bgra8))
+		expand8(srcPtr, dstPtr, count, false);
+	else if((src == L::rgb8 && dst == L::bgra8) || (src == L::bgr8 && dst == L::rgba8))
+		expand8(srcPtr, dstPtr, count, true);
+	else if((src == L::rgba8 && dst == L::bgra8) || (src == L::bgra8 && dst == L::rgba8))
+		swizzle8(srcPtr, dstPtr, count);
+	else if(src == L::rgba16 && dst == L::rgba8)
+		pack16(src16, dstPtr, count * 4);
+	else if(src == L::rgba32f && dst == L::rgba8)
+		packUnorm8(srcFloat, dstPtr, count * 4);
+	else if(src == L::rgba32f && dst == L::rgba16f)
+		packHalf(srcFloat, dst16, count * 4);
+	else if(src == L::rgb32f && dst == L::rgba16f)
+		expandHalf(srcFloat, dst16, count);
+	else
+		throw std::logic_error("vpp::convertTexels: formats are not convertible");
+}
+
+}
@@ -9,13 +9,14 @@
 #include <cstdlib>
 #include <thread>
 #include <mutex>
+#include <atomic>
 
 namespace vpp
 {
 
 struct Device::TLStorage
 {
-	std::vector<CommandPool> commandPools;
+	std::deque<CommandPool> commandPools;
 	std::pmr::unsynchronized_pool_resource memoryResource;
 	DeviceMemoryAllocator deviceAllocator;
 	// VulkanAllocator vulkanAllocator;
@@ -28,22 +29,45 @@ struct Device::TLStorage
 //XXX: care for order in this structure since some of the vars depend on each other.
 //i.e. tlStorage (with deviceAllocator and memoryResource) should not be placed after
 //submitManager or transferManger or commandProvider.
+//The queues (and the properties they reference) must outlive the submitManager and
+//completionMonitor whose threads use them.
 struct Device::Impl
 {
+	vk::PhysicalDeviceProperties physicalDeviceProperties;
+	vk::PhysicalDeviceMemoryProperties memoryProperties;
+
+	std::vector<vk::QueueFamilyProperties> qFamilyProperties;
+	std::vector<std::unique_ptr<Queue>> queues;
+
 	std::map<std::thread::id, TLStorage> tlStorage;
 	std::mutex storageMutex; //use a shared_mutex here with c++17.
+	std::atomic<std::uint64_t> idleCount {}; //how often the device was waited idle
 
 	CommandProvider commandProvider;
+	FencePool fencePool;
+	SemaphorePool semaphorePool;
+	CompletionMonitor completionMonitor;
 	SubmitManager submitManager;
 	TransferManager transferManager;
 
-	vk::PhysicalDeviceProperties physicalDeviceProperties;
-	vk::PhysicalDeviceMemoryProperties memoryProperties;
+	Impl(const Device& dev) : commandProvider(dev), fencePool(dev), semaphorePool(dev),
+		completionMonitor(dev), submitManager(dev), transferManager(dev) {}
 
-	std::vector<vk::QueueFamilyProperties> qFamilyProperties;
-	std::vector<std::unique_ptr<Queue>> queues;
-
-	Impl(const Device& dev) : commandProvider(dev), submitManager(dev), transferManager(dev) {}
+	~Impl()
+	{
+		//no thread may submit or run callbacks while the members are destroyed.
+		//Submissions still queued are flushed so their fences can be signaled and
+		//all work must be completed before the pools (and the device) are destroyed.
+		//No other thread submits anymore, so the queues do not have to be locked
+		submitManager.stopThread();
+		submitManager.submit();
+		vk::deviceWaitIdle(submitManager.vkDevice());
+		completionMonitor.stopThread();
+
+		//the recycled command buffers reference fences of the pool destroyed before them
+		for(auto& storage : tlStorage)
+			for(auto& pool : storage.second.commandPools) pool.freeRecycled();
+	}
 };
 
 //Device
@@ -71,6 +95,7 @@ Device::Device(vk::Instance ini, vk::PhysicalDevice phdev, const vk::DeviceCreat
 			queueInfo.queueFamilyIndex, idx));
 	}
 
+	impl_->submitManager.init();
 	tlStorage(); //automatically provide storage for this thread. XXX: useful?
 }
 
@@ -94,6 +119,7 @@ Device::Device(vk::Instance ini, vk::PhysicalDevice phdev, vk::Device device,
 			queues[i].first, queues[i].second));
 	}
 
+	impl_->submitManager.init();
 	tlStorage(); //automatically provide storage for this thread. XXX: useful?
 }
 
@@ -118,6 +144,7 @@ Device::Device(vk::Instance ini, vk::PhysicalDevice phdev, vk::Device device,
 			impl_->qFamilyProperties[queues[i].second], id, queues[i].second));
 	}
 
+	impl_->submitManager.init();
 	tlStorage(); //automatically provide storage for this thread. XXX: useful?
 }
 
@@ -135,7 +162,17 @@ void Device::release()
 
 void Device::waitIdle() const
 {
+	//vkDeviceWaitIdle requires all queues to be externally synchronized
+	auto&& lock = submitManager().acquire();
 	vk::deviceWaitIdle(vkDevice());
+
+	//no command buffer is pending anymore, the destructed ones can be reused
+	++impl_->idleCount;
+}
+
+std::uint64_t Device::idleCount() const
+{
+	return impl_->idleCount.load();
 }
 
 Range<std::unique_ptr<Queue>> Device::queues() const
@@ -227,6 +264,26 @@ SubmitManager& Device::submitManager() const
 	return impl_->submitManager;
 }
 
+FencePool& Device::fencePool() const
+{
+	return impl_->fencePool;
+}
+
+SemaphorePool& Device::semaphorePool() const
+{
+	return impl_->semaphorePool;
+}
+
+CompletionMonitor& Device::completionMonitor() const
+{
+	return impl_->completionMonitor;
+}
+
+std::size_t Device::pollCompletions() const
+{
+	return impl_->completionMonitor.poll();
+}
+
 TransferManager& Device::transferManager() const
 {
 	return impl_->transferManager;
@@ -247,7 +304,7 @@ Device::TLStorage& Device::tlStorage() const
 	return it->second;
 }
 
-std::vector<CommandPool>& Device::tlCommandPools() const
+std::deque<CommandPool>& Device::tlCommandPools() const
 {
 	auto& storage = tlStorage();
 	return storage.commandPools;
@@ -0,0 +1,727 @@
+#include <vpp/frameGraph.hpp>
+#include <vpp/memory.hpp>
+#include <vpp/provider.hpp>
+#include <vpp/recordThreads.hpp>
+#include <vpp/vk.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace vpp
+{
+
+namespace
+{
+
+bool reads(vk::AccessFlags access) { return (access ^ writeAccess(access)); }
+bool writes(vk::AccessFlags access) { return writeAccess(access); }
+
+vk::ImageUsageFlags layoutUsage(vk::ImageLayout layout)
+{
+	switch(layout)
+	{
+		case vk::ImageLayout::colorAttachmentOptimal: return vk::ImageUsageBits::colorAttachment;
+		case vk::ImageLayout::depthStencilAttachmentOptimal:
+			return vk::ImageUsageBits::depthStencilAttachment;
+		case vk::ImageLayout::shaderReadOnlyOptimal: return vk::ImageUsageBits::sampled;
+		case vk::ImageLayout::general: return vk::ImageUsageBits::storage;
+		case vk::ImageLayout::transferSrcOptimal: return vk::ImageUsageBits::transferSrc;
+		case vk::ImageLayout::transferDstOptimal: return vk::ImageUsageBits::transferDst;
+		default: return {};
+	}
+}
+
+}
+
+//Worker threads recording the passes into secondary command buffers.
+struct FrameGraph::Recorder : public RecordThreads
+{
+	using RecordThreads::RecordThreads;
+};
+
+//FramePass
+FramePass& FramePass::use(FrameResource res, vk::ImageLayout layout, vk::AccessFlags access,
+	vk::PipelineStageFlags stages)
+{
+	uses_.push_back({res, layout, access, stages});
+	return *this;
+}
+
+FramePass& FramePass::color(FrameResource image, vk::AttachmentLoadOp loadOp,
+	const vk::ClearColorValue& clear)
+{
+	vk::ClearValue value {};
+	value.color = clear;
+	attachments_.push_back({image, loadOp, value, false});
+
+	vk::AccessFlags access = vk::AccessBits::colorAttachmentWrite;
+	if(loadOp == vk::AttachmentLoadOp::load) access |= vk::AccessBits::colorAttachmentRead;
+	return use(image, vk::ImageLayout::colorAttachmentOptimal, access,
+		vk::PipelineStageBits::colorAttachmentOutput);
+}
+
+FramePass& FramePass::depthStencil(FrameResource image, vk::AttachmentLoadOp loadOp,
+	const vk::ClearDepthStencilValue& clear)
+{
+	vk::ClearValue value {};
+	value.depthStencil = clear;
+	attachments_.push_back({image, loadOp, value, true});
+
+	vk::AccessFlags access = vk::AccessBits::depthStencilAttachmentWrite;
+	if(loadOp == vk::AttachmentLoadOp::load) access |= vk::AccessBits::depthStencilAttachmentRead;
+	return use(image, vk::ImageLayout::depthStencilAttachmentOptimal, access,
+		vk::PipelineStageBits::earlyFragmentTests | vk::PipelineStageBits::lateFragmentTests);
+}
+
+FramePass& FramePass::sampled(FrameResource image, vk::PipelineStageFlags stages)
+{
+	return use(image, vk::ImageLayout::shaderReadOnlyOptimal, vk::AccessBits::shaderRead, stages);
+}
+
+FramePass& FramePass::storage(FrameResource image, bool write, vk::PipelineStageFlags stages)
+{
+	vk::AccessFlags access = vk::AccessBits::shaderRead;
+	if(write) access |= vk::AccessBits::shaderWrite;
+	return use(image, vk::ImageLayout::general, access, stages);
+}
+
+FramePass& FramePass::transferSrc(FrameResource image)
+{
+	return use(image, vk::ImageLayout::transferSrcOptimal, vk::AccessBits::transferRead,
+		vk::PipelineStageBits::transfer);
+}
+
+FramePass& FramePass::transferDst(FrameResource image)
+{
+	return use(image, vk::ImageLayout::transferDstOptimal, vk::AccessBits::transferWrite,
+		vk::PipelineStageBits::transfer);
+}
+
+FramePass& FramePass::read(FrameResource buffer, vk::AccessFlags access,
+	vk::PipelineStageFlags stages)
+{
+	return use(buffer, vk::ImageLayout::undefined, access ^ writeAccess(access), stages);
+}
+
+FramePass& FramePass::write(FrameResource buffer, vk::AccessFlags access,
+	vk::PipelineStageFlags stages)
+{
+	return use(buffer, vk::ImageLayout::undefined, access, stages);
+}
+
+FramePass& FramePass::sideEffects()
+{
+	sideEffects_ = true;
+	return *this;
+}
+
+FramePass& FramePass::record(RecordFunc func)
+{
+	record_ = std::move(func);
+	return *this;
+}
+
+//FrameGraph
+FrameGraph::FrameGraph(const Device& dev, unsigned int queueFamily, unsigned int recordThreads)
+	: Resource(dev), queueFamily_(queueFamily), recordThreads_(recordThreads),
+		tracker_(dev.queueFamilyProperties(queueFamily).queueFlags)
+{
+}
+
+FrameGraph::~FrameGraph()
+{
+	recorder_.reset();
+	destroyTransients();
+}
+
+FrameResource FrameGraph::image(const ImageInfo& info)
+{
+	if(compiled_) throw std::logic_error("vpp::FrameGraph::image: graph already compiled");
+
+	resources_.emplace_back();
+	resources_.back().info = info;
+	return resources_.size() - 1;
+}
+
+FrameResource FrameGraph::importImage(vk::Image image, vk::ImageView view, const ImageInfo& info,
+	vk::ImageLayout initialLayout, vk::ImageLayout finalLayout)
+{
+	if(compiled_) throw std::logic_error("vpp::FrameGraph::importImage: graph already compiled");
+
+	resources_.emplace_back();
+	auto& entry = resources_.back();
+	entry.imported = true;
+	entry.info = info;
+	entry.image = image;
+	entry.view = view;
+	entry.initialLayout = initialLayout;
+	entry.finalLayout = finalLayout;
+	return resources_.size() - 1;
+}
+
+FrameResource FrameGraph::importBuffer(vk::Buffer buffer, vk::DeviceSize offset,
+	vk::DeviceSize size)
+{
+	if(compiled_) throw std::logic_error("vpp::FrameGraph::importBuffer: graph already compiled");
+
+	resources_.emplace_back();
+	auto& entry = resources_.back();
+	entry.buffer = true;
+	entry.imported = true;
+	entry.vkBuffer = buffer;
+	entry.offset = offset;
+	entry.size = size;
+	return resources_.size() - 1;
+}
+
+void FrameGraph::reimport(FrameResource image, vk::Image vkImage, vk::ImageView view)
+{
+	auto& entry = resources_.at(image);
+	if(!entry.imported || entry.buffer)
+		throw std::logic_error("vpp::FrameGraph::reimport: not an imported image");
+
+	if(entry.image == vkImage && entry.view == view) return;
+
+	tracker_.forget(entry.image);
+	entry.image = vkImage;
+	entry.view = view;
+	reimported_.push_back(image);
+}
+
+FramePass& FrameGraph::pass(std::string name)
+{
+	if(compiled_) throw std::logic_error("vpp::FrameGraph::pass: graph already compiled");
+
+	passes_.push_back(FramePass(std::move(name)));
+	return passes_.back();
+}
+
+vk::Image FrameGraph::vkImage(FrameResource image) const
+{
+	return resources_.at(image).image;
+}
+
+vk::ImageView FrameGraph::vkImageView(FrameResource image) const
+{
+	return resources_.at(image).view;
+}
+
+void FrameGraph::compile()
+{
+	if(compiled_) return;
+
+	for(auto& pass : passes_)
+		for(auto& use : pass.uses_)
+			if(use.resource >= resources_.size())
+				throw std::logic_error("vpp::FrameGraph::compile: invalid resource in " + pass.name_);
+
+	cull();
+	sort();
+	allocate();
+
+	for(auto& pass : order_)
+	{
+		if(!pass->renderPass()) continue;
+		createRenderPass(*pass);
+		createFramebuffer(*pass);
+	}
+
+	if(recordThreads_) recorder_ = std::make_unique<Recorder>(recordThreads_);
+	compiled_ = true;
+}
+
+void FrameGraph::cull()
+{
+	//the passes that wrote the contents each pass reads
+	std::vector<std::vector<unsigned int>> dependencies(passes_.size());
+	std::vector<int> lastWriter(resources_.size(), -1);
+	std::vector<unsigned int> live;
+
+	for(auto i = 0u; i < passes_.size(); ++i)
+	{
+		auto& pass = passes_[i];
+		for(auto& use : pass.uses_)
+			if(reads(use.access) && lastWriter[use.resource] >= 0)
+				dependencies[i].push_back(lastWriter[use.resource]);
+
+		auto output = pass.sideEffects_;
+		for(auto& use : pass.uses_)
+		{
+			if(!writes(use.access)) continue;
+			lastWriter[use.resource] = i;
+			output |= resources_[use.resource].imported;
+		}
+
+		if(output) live.push_back(i);
+	}
+
+	for(auto& pass : passes_) pass.culled_ = true;
+	while(!live.empty())
+	{
+		auto& pass = passes_[live.back()];
+		auto& deps = dependencies[live.back()];
+		live.pop_back();
+
+		if(!pass.culled_) continue;
+		pass.culled_ = false;
+		live.insert(live.end(), deps.begin(), deps.end());
+	}
+}
+
+void FrameGraph::sort()
+{
+	//build the edges between the passes that are not culled
+	std::vector<std::vector<unsigned int>> edges(passes_.size());
+	std::vector<unsigned int> incoming(passes_.size());
+	std::vector<int> lastWriter(resources_.size(), -1);
+	std::vector<std::vector<unsigned int>> readers(resources_.size());
+
+	auto edge = [&](int from, unsigned int to) {
+		if(from < 0 || static_cast<unsigned int>(from) == to) return;
+		auto& out = edges[from];
+		if(std::find(out.begin(), out.end(), to) != out.end()) return;
+		out.push_back(to);
+		++incoming[to];
+	};
+
+	for(auto i = 0u; i < passes_.size(); ++i)
+	{
+		if(passes_[i].culled_) continue;
+		for(auto& use : passes_[i].uses_)
+		{
+			if(!reads(use.access)) continue;
+			edge(lastWriter[use.resource], i);
+			readers[use.resource].push_back(i);
+		}
+
+		for(auto& use : passes_[i].uses_)
+		{
+			if(!writes(use.access)) continue;
+			edge(lastWriter[use.resource], i);
+			for(auto reader : readers[use.resource]) edge(reader, i);
+			readers[use.resource].clear();
+			lastWriter[use.resource] = i;
+		}
+	}
+
+	//topological sort that prefers passes not depending on the previously recorded one
+	//so that dependent passes are further apart and need fewer pipeline stalls
+	std::vector<unsigned int> ready;
+	for(auto i = 0u; i < passes_.size(); ++i)
+		if(!passes_[i].culled_ && !incoming[i]) ready.push_back(i);
+
+	order_.clear();
+	stats_ = {};
+	int last = -1;
+	while(!ready.empty())
+	{
+		auto best = ready.begin();
+		if(last >= 0)
+		{
+			auto& out = edges[last];
+			auto independent = std::find_if(ready.begin(), ready.end(), [&](unsigned int i) {
+				return std::find(out.begin(), out.end(), i) == out.end(); });
+			if(independent != ready.end()) best = independent;
+		}
+
+		last = *best;
+		ready.erase(best);
+		order_.push_back(&passes_[last]);
+
+		for(auto next : edges[last])
+		{
+			if(--incoming[next]) continue;
+			ready.insert(std::lower_bound(ready.begin(), ready.end(), next), next);
+		}
+	}
+
+	stats_.passes = order_.size();
+	stats_.culled = passes_.size() - order_.size();
+}
+
+void FrameGraph::allocate()
+{
+	for(auto i = 0u; i < order_.size(); ++i)
+	{
+		for(auto& use : order_[i]->uses_)
+		{
+			auto& res = resources_[use.resource];
+			if(res.firstUse < 0) res.firstUse = i;
+			res.lastUse = i;
+			res.usage |= layoutUsage(use.layout);
+		}
+	}
+
+	struct Placed
+	{
+		FrameResource resource;
+		vk::DeviceSize offset;
+		vk::DeviceSize end;
+	};
+
+	struct Heap
+	{
+		unsigned int type;
+		vk::DeviceSize size;
+		std::vector<Placed> placed;
+	};
+
+	//create the transient images
+	std::vector<std::pair<FrameResource, vk::MemoryRequirements>> transients;
+	for(auto i = 0u; i < resources_.size(); ++i)
+	{
+		auto& res = resources_[i];
+		if(res.imported || res.firstUse < 0) continue;
+
+		vk::ImageCreateInfo info;
+		info.imageType = vk::ImageType::e2d;
+		info.format = res.info.format;
+		info.extent = {res.info.extent.width, res.info.extent.height, 1};
+		info.mipLevels = 1;
+		info.arrayLayers = 1;
+		info.samples = res.info.samples;
+		info.tiling = vk::ImageTiling::optimal;
+		info.usage = res.usage | res.info.usage;
+		info.sharingMode = vk::SharingMode::exclusive;
+		info.initialLayout = vk::ImageLayout::undefined;
+
+		res.image = vk::createImage(vkDevice(), info);
+		transients.push_back({i, vk::getImageMemoryRequirements(vkDevice(), res.image)});
+		stats_.transientSize += transients.back().second.size;
+	}
+
+	//place the largest images first, images only share memory if their lifetimes
+	//do not overlap
+	std::stable_sort(transients.begin(), transients.end(), [](const auto& a, const auto& b) {
+		return a.second.size > b.second.size; });
+
+	auto overlap = [&](FrameResource a, FrameResource b) {
+		return resources_[a].firstUse <= resources_[b].lastUse &&
+			resources_[b].firstUse <= resources_[a].lastUse;
+	};
+
+	std::vector<Heap> heaps;
+	for(auto& transient : transients)
+	{
+		auto& res = resources_[transient.first];
+		auto& reqs = transient.second;
+
+		auto type = device().memoryType(vk::MemoryPropertyBits::deviceLocal,
+			reqs.memoryTypeBits);
+		if(type < 0) type = device().memoryType({}, reqs.memoryTypeBits);
+		if(type < 0) throw std::runtime_error("vpp::FrameGraph: no memory type for image");
+
+		auto heap = std::find_if(heaps.begin(), heaps.end(),
+			[&](const Heap& h) { return h.type == static_cast<unsigned int>(type); });
+		if(heap == heaps.end())
+		{
+			heaps.push_back({static_cast<unsigned int>(type), 0, {}});
+			heap = heaps.end() - 1;
+		}
+
+		//the lowest offset not colliding with any placed image that is alive at the same time
+		auto align = [&](vk::DeviceSize off) {
+			return ((off + reqs.alignment - 1) / reqs.alignment) * reqs.alignment; };
+		auto collides = [&](vk::DeviceSize off) {
+			for(auto& p : heap->placed)
+				if(overlap(p.resource, transient.first) && off < p.end && p.offset < off + reqs.size)
+					return true;
+			return false;
+		};
+
+		vk::DeviceSize offset = 0;
+		if(collides(offset))
+		{
+			offset = ~vk::DeviceSize(0);
+			for(auto& p : heap->placed)
+			{
+				auto candidate = align(p.end);
+				if(candidate < offset && !collides(candidate)) offset = candidate;
+			}
+		}
+
+		heap->placed.push_back({transient.first, offset, offset + reqs.size});
+		heap->size = std::max(heap->size, offset + reqs.size);
+		res.memory = heap - heaps.begin();
+		res.memoryOffset = offset;
+	}
+
+	//allocate the memory, bind the images and create the views
+	auto queueFlags = device().queueFamilyProperties(queueFamily_).queueFlags;
+	for(auto& heap : heaps)
+	{
+		vk::MemoryAllocateInfo allocInfo;
+		allocInfo.allocationSize = heap.size;
+		allocInfo.memoryTypeIndex = heap.type;
+		memories_.push_back(std::make_unique<DeviceMemory>(device(), allocInfo));
+		stats_.allocatedSize += heap.size;
+
+		for(auto& placed : heap.placed)
+		{
+			auto& res = resources_[placed.resource];
+			vk::bindImageMemory(vkDevice(), res.image, *memories_.back(), placed.offset);
+
+			vk::ImageViewCreateInfo info;
+			info.image = res.image;
+			info.viewType = vk::ImageViewType::e2d;
+			info.format = res.info.format;
+			info.subresourceRange = {res.info.aspects, 0, 1, 0, 1};
+			res.view = vk::createImageView(vkDevice(), info);
+
+			//the first use in a frame has to wait for all previous uses of the memory,
+			//either by an aliased image or by the previous frame
+			auto& state = res.initialState;
+			for(auto& other : heap.placed)
+			{
+				if(other.offset >= placed.end || placed.offset >= other.end) continue;
+				for(auto& pass : order_)
+				{
+					for(auto& use : pass->uses_)
+					{
+						if(use.resource != other.resource) continue;
+
+						//reads have to finish before the memory is written again
+						auto stages = use.stages;
+						if(!stages) stages = accessStages(use.access, queueFlags);
+						if(writes(use.access))
+						{
+							state.writeAccess |= writeAccess(use.access);
+							state.writeStages |= stages;
+						}
+
+						if(reads(use.access)) state.readStages |= stages;
+					}
+				}
+			}
+		}
+	}
+}
+
+void FrameGraph::createRenderPass(FramePass& pass)
+{
+	auto index = std::find(order_.begin(), order_.end(), &pass) - order_.begin();
+
+	std::vector<vk::AttachmentDescription> descriptions;
+	std::vector<vk::AttachmentReference> colorRefs;
+	vk::AttachmentReference depthRef;
+	bool depth = false;
+
+	pass.extent_ = {~0u, ~0u};
+	for(auto& attachment : pass.attachments_)
+	{
+		auto& res = resources_[attachment.resource];
+		auto layout = attachment.depth ? vk::ImageLayout::depthStencilAttachmentOptimal :
+			vk::ImageLayout::colorAttachmentOptimal;
+
+		//the contents only have to be stored if they are used later on
+		auto store = (res.imported || res.lastUse > index) ? vk::AttachmentStoreOp::store :
+			vk::AttachmentStoreOp::dontCare;
+
+		vk::AttachmentDescription desc;
+		desc.format = res.info.format;
+		desc.samples = res.info.samples;
+		desc.loadOp = attachment.loadOp;
+		desc.storeOp = store;
+		desc.stencilLoadOp = attachment.depth ? attachment.loadOp : vk::AttachmentLoadOp::dontCare;
+		desc.stencilStoreOp = attachment.depth ? store : vk::AttachmentStoreOp::dontCare;
+		desc.initialLayout = layout;
+		desc.finalLayout = layout;
+
+		if(attachment.depth)
+		{
+			depthRef = {static_cast<unsigned int>(descriptions.size()), layout};
+			depth = true;
+		}
+		else
+		{
+			colorRefs.push_back({static_cast<unsigned int>(descriptions.size()), layout});
+		}
+
+		descriptions.push_back(desc);
+		pass.extent_.width = std::min(pass.extent_.width, res.info.extent.width);
+		pass.extent_.height = std::min(pass.extent_.height, res.info.extent.height);
+	}
+
+	//all dependencies are handled by the pipeline barriers recorded before the render pass
+	vk::SubpassDescription subpass;
+	subpass.pipelineBindPoint = vk::PipelineBindPoint::graphics;
+	subpass.colorAttachmentCount = colorRefs.size();
+	subpass.pColorAttachments = colorRefs.data();
+	if(depth) subpass.pDepthStencilAttachment = &depthRef;
+
+	vk::RenderPassCreateInfo info;
+	info.attachmentCount = descriptions.size();
+	info.pAttachments = descriptions.data();
+	info.subpassCount = 1;
+	info.pSubpasses = &subpass;
+
+	pass.renderPass_ = RenderPass(device(), info);
+}
+
+void FrameGraph::createFramebuffer(FramePass& pass)
+{
+	std::vector<vk::ImageView> views;
+	views.reserve(pass.attachments_.size());
+	for(auto& attachment : pass.attachments_)
+		views.push_back(resources_[attachment.resource].view);
+
+	vk::FramebufferCreateInfo info;
+	info.renderPass = pass.renderPass_;
+	info.attachmentCount = views.size();
+	info.pAttachments = views.data();
+	info.width = pass.extent_.width;
+	info.height = pass.extent_.height;
+	info.layers = 1;
+
+	pass.framebuffer_ = Framebuffer(device(), pass.extent_,
+		vk::createFramebuffer(vkDevice(), info));
+}
+
+void FrameGraph::record(vk::CommandBuffer cmdBuffer)
+{
+	compile();
+
+	//recreate the framebuffers using reimported images
+	for(auto res : reimported_)
+	{
+		for(auto& pass : order_)
+		{
+			auto& atts = pass->attachments_;
+			if(std::any_of(atts.begin(), atts.end(),
+					[&](const FramePass::Attachment& a) { return a.resource == res; }))
+				createFramebuffer(*pass);
+		}
+	}
+
+	reimported_.clear();
+
+	if(recorder_)
+	{
+		for(auto i = 0u; i < order_.size(); ++i)
+		{
+			auto pass = order_[i];
+			if(pass->record_) recorder_->add(i, [=]{ recordPass(*pass, {}, true); });
+		}
+	}
+
+	//reset the tracked states to the start of the frame while the workers record
+	for(auto& res : resources_)
+	{
+		if(res.firstUse < 0) continue;
+
+		ResourceStateTracker::State state;
+		if(!res.imported) state = res.initialState;
+		else
+		{
+			//imported resources wait for (and make visible) all previous commands
+			state.writeAccess = vk::AccessBits::memoryWrite;
+			state.writeStages = vk::PipelineStageBits::allCommands;
+		}
+
+		if(res.buffer)
+		{
+			tracker_.track(res.vkBuffer, state);
+		}
+		else
+		{
+			if(res.imported) state.layout = res.initialLayout;
+			tracker_.track(res.image, 1, 1, res.info.aspects, state);
+		}
+	}
+
+	if(recorder_) recorder_->wait();
+
+	std::vector<vk::ClearValue> clearValues;
+	for(auto& passPtr : order_)
+	{
+		auto& pass = *passPtr;
+		for(auto& use : pass.uses_)
+		{
+			auto& res = resources_[use.resource];
+			if(res.buffer) tracker_.use(res.vkBuffer, res.offset, res.size, use.access, use.stages);
+			else tracker_.use(res.image, {res.info.aspects, 0, 1, 0, 1}, use.layout, use.access,
+				use.stages);
+		}
+
+		tracker_.flush(cmdBuffer);
+
+		if(pass.renderPass())
+		{
+			clearValues.clear();
+			for(auto& attachment : pass.attachments_) clearValues.push_back(attachment.clear);
+
+			vk::RenderPassBeginInfo beginInfo;
+			beginInfo.renderPass = pass.renderPass_;
+			beginInfo.framebuffer = pass.framebuffer_;
+			beginInfo.renderArea = {{0, 0}, pass.extent_};
+			beginInfo.clearValueCount = clearValues.size();
+			beginInfo.pClearValues = clearValues.data();
+
+			auto contents = recorder_ ? vk::SubpassContents::secondaryCommandBuffers :
+				vk::SubpassContents::eInline;
+			vk::cmdBeginRenderPass(cmdBuffer, beginInfo, contents);
+		}
+
+		if(!recorder_) recordPass(pass, cmdBuffer, false);
+		else if(pass.record_) vk::cmdExecuteCommands(cmdBuffer, {pass.commandBuffer_.vkHandle()});
+
+		if(pass.renderPass()) vk::cmdEndRenderPass(cmdBuffer);
+	}
+
+	//change the imported images into their final layouts
+	for(auto& res : resources_)
+	{
+		if(res.buffer || !res.imported || res.firstUse < 0) continue;
+		if(res.finalLayout == vk::ImageLayout::undefined) continue;
+		tracker_.use(res.image, {res.info.aspects, 0, 1, 0, 1}, res.finalLayout, {});
+	}
+
+	tracker_.flush(cmdBuffer);
+}
+
+void FrameGraph::recordPass(FramePass& pass, vk::CommandBuffer cmdBuffer, bool secondary)
+{
+	if(!pass.record_) return;
+	if(!secondary)
+	{
+		pass.record_(cmdBuffer, pass);
+		return;
+	}
+
+	//allocated from the command pool of the calling worker thread
+	auto& buffer = pass.commandBuffer_;
+	if(!buffer.vkHandle())
+		buffer = device().commandProvider().get(queueFamily_, {},
+			vk::CommandBufferLevel::secondary);
+
+	vk::CommandBufferInheritanceInfo inheritance;
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.pInheritanceInfo = &inheritance;
+	if(pass.renderPass())
+	{
+		inheritance.renderPass = pass.renderPass_;
+		inheritance.subpass = 0;
+		inheritance.framebuffer = pass.framebuffer_;
+		beginInfo.flags = vk::CommandBufferUsageBits::renderPassContinue;
+	}
+
+	vk::beginCommandBuffer(buffer, beginInfo);
+	pass.record_(buffer, pass);
+	vk::endCommandBuffer(buffer);
+}
+
+void FrameGraph::destroyTransients()
+{
+	for(auto& res : resources_)
+	{
+		if(res.imported) continue;
+		if(res.view) vk::destroyImageView(vkDevice(), res.view);
+		if(res.image) vk::destroyImage(vkDevice(), res.image);
+		res.view = {};
+		res.image = {};
+	}
+
+	memories_.clear();
+}
+
+}
@@ -0,0 +1,223 @@
+#include <vpp/frameTimings.hpp>
+#include <vpp/vk.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+
+namespace vpp
+{
+
+namespace
+{
+
+constexpr unsigned int pointIndex(FrameTimings::Point point)
+{
+	return static_cast<unsigned int>(point);
+}
+
+double milliseconds(FrameTimings::Clock::time_point from, FrameTimings::Clock::time_point to)
+{
+	using Milli = std::chrono::duration<double, std::milli>;
+	return std::chrono::duration_cast<Milli>(to - from).count();
+}
+
+}
+
+FrameTimings::FrameTimings(const Device& dev, unsigned int capacity, unsigned int queries,
+	unsigned int queueFamily) : Resource(dev), frames_(capacity), fences_(capacity)
+{
+	if(!capacity) throw std::logic_error("vpp::FrameTimings: capacity must not be 0");
+	values_.reserve(capacity);
+
+	//timestamps are only supported if the queue family has valid bits
+	queries_ = queries;
+	auto validBits = dev.queueFamilyProperties(queueFamily).timestampValidBits;
+	if(!queries || !validBits) return;
+
+	timestampPeriod_ = dev.properties().limits.timestampPeriod;
+	timestampMask_ = (validBits >= 64) ? std::numeric_limits<std::uint64_t>::max() :
+		(std::uint64_t(1) << validBits) - 1;
+
+	vk::QueryPoolCreateInfo info;
+	info.queryType = vk::QueryType::timestamp;
+	info.queryCount = 2 * queries;
+	queryPool_ = vk::createQueryPool(vkDevice(), info);
+}
+
+FrameTimings::~FrameTimings()
+{
+	//the query results of pending frames are simply dropped
+	fences_.clear();
+	if(queryPool_) vk::destroyQueryPool(vkDevice(), queryPool_);
+}
+
+void FrameTimings::begin()
+{
+	poll();
+
+	current_ = count_ ? (current_ + 1) % frames_.size() : 0;
+	count_ = std::min<unsigned int>(count_ + 1, frames_.size());
+
+	//the oldest frame is replaced, even if it did not complete yet
+	fences_[current_] = {};
+	frames_[current_] = {};
+	frames_[current_].points[pointIndex(Point::acquireBegin)] = Clock::now();
+}
+
+void FrameTimings::mark(Point point)
+{
+	frames_[current_].points[pointIndex(point)] = Clock::now();
+}
+
+void FrameTimings::query(unsigned int id)
+{
+	auto& frame = frames_[current_];
+	frame.id = id;
+	frame.query = queryPool_ && id < queries_;
+	if(!frame.query) return;
+
+	//the commands writing the timestamps are executed again, so the results
+	//of previous frames using them must be read now
+	for(auto i = 0u; i < frames_.size(); ++i)
+		if(i != current_ && fences_[i] && frames_[i].query && frames_[i].id == id)
+			complete(i, true);
+}
+
+void FrameTimings::submitted(const FenceRef& fence)
+{
+	fences_[current_] = fence;
+}
+
+void FrameTimings::poll()
+{
+	for(auto i = 0u; i < frames_.size(); ++i)
+		if(fences_[i]) complete(i, false);
+}
+
+bool FrameTimings::complete(unsigned int index, bool wait)
+{
+	auto fence = fences_[index].vkFence();
+	if(wait)
+	{
+		vk::waitForFences(vkDevice(), {fence}, true, ~std::uint64_t(0));
+	}
+	else if(vk::getFenceStatus(vkDevice(), fence) != vk::Result::success)
+	{
+		return false;
+	}
+
+	auto& frame = frames_[index];
+	frame.points[pointIndex(Point::completed)] = Clock::now();
+	frame.completed = true;
+	fences_[index] = {};
+
+	if(frame.query)
+	{
+		std::uint64_t stamps[2] {};
+		auto res = vk::getQueryPoolResults(vkDevice(), queryPool_, 2 * frame.id, 2,
+			sizeof(stamps), stamps, sizeof(stamps[0]), vk::QueryResultBits::e64);
+		if(res == vk::Result::success)
+		{
+			auto ticks = (stamps[1] - stamps[0]) & timestampMask_;
+			frame.gpu = (ticks * timestampPeriod_) / 1000000.0;
+		}
+	}
+
+	return true;
+}
+
+void FrameTimings::writeBegin(vk::CommandBuffer cmdBuffer, unsigned int id) const
+{
+	if(!queryPool_ || id >= queries_) return;
+
+	vk::cmdResetQueryPool(cmdBuffer, queryPool_, 2 * id, 2);
+	vk::cmdWriteTimestamp(cmdBuffer, vk::PipelineStageBits::topOfPipe, queryPool_, 2 * id);
+}
+
+void FrameTimings::writeEnd(vk::CommandBuffer cmdBuffer, unsigned int id) const
+{
+	if(!queryPool_ || id >= queries_) return;
+	vk::cmdWriteTimestamp(cmdBuffer, vk::PipelineStageBits::bottomOfPipe, queryPool_, 2 * id + 1);
+}
+
+const FrameTimings::Frame& FrameTimings::frame(unsigned int age) const
+{
+	if(age >= count_) throw std::out_of_range("vpp::FrameTimings::frame");
+	return frames_[(current_ + frames_.size() - age) % frames_.size()];
+}
+
+double FrameTimings::value(Metric metric, unsigned int age) const
+{
+	auto& frame = this->frame(age);
+	auto span = [&](Point from, Point to) {
+		auto& a = frame.points[pointIndex(from)];
+		auto& b = frame.points[pointIndex(to)];
+		if(a == Clock::time_point {} || b == Clock::time_point {}) return -1.0;
+		return milliseconds(a, b);
+	};
+
+	switch(metric)
+	{
+		case Metric::frameTime:
+		{
+			if(age + 1 >= count_) return -1.0;
+			auto& prev = this->frame(age + 1);
+			return milliseconds(prev.points[pointIndex(Point::acquireBegin)],
+				frame.points[pointIndex(Point::acquireBegin)]);
+		}
+		case Metric::acquire: return span(Point::acquireBegin, Point::acquireEnd);
+		case Metric::frame: return span(Point::acquireEnd, Point::frameEnd);
+		case Metric::record: return span(Point::frameEnd, Point::recordEnd);
+		case Metric::submit: return span(Point::recordEnd, Point::submitEnd);
+		case Metric::present: return span(Point::submitEnd, Point::presentEnd);
+		case Metric::latency: return span(Point::acquireBegin, Point::completed);
+		case Metric::gpu: return frame.gpu;
+		default: return -1.0;
+	}
+}
+
+FrameTimings::Summary FrameTimings::summary(Metric metric) const
+{
+	values_.clear();
+	for(auto i = 0u; i < count_; ++i)
+	{
+		auto val = value(metric, i);
+		if(val >= 0.0) values_.push_back(val);
+	}
+
+	Summary ret;
+	ret.count = values_.size();
+	if(values_.empty()) return ret;
+
+	std::sort(values_.begin(), values_.end());
+	auto percentile = [&](double p) {
+		auto rank = static_cast<std::size_t>(std::ceil(p * values_.size()));
+		return values_[std::max<std::size_t>(rank, 1) - 1];
+	};
+
+	ret.p50 = percentile(0.5);
+	ret.p99 = percentile(0.99);
+	ret.max = values_.back();
+	return ret;
+}
+
+void FrameTimings::writeCSV(std::ostream& os) const
+{
+	os << "index,frameTime,acquire,frame,record,submit,present,latency,gpu\n";
+	for(auto age = count_; age-- > 0;)
+	{
+		os << count_ - 1 - age;
+		for(auto m = 0u; m < static_cast<unsigned int>(Metric::count); ++m)
+		{
+			os << ',';
+			auto val = value(static_cast<Metric>(m), age);
+			if(val >= 0.0) os << val;
+		}
+		os << '\n';
+	}
+}
+
+}
@@ -4,6 +4,8 @@
 #include <vpp/vk.hpp>
 #include <vpp/utility/range.hpp>
 
+#include <algorithm>
+
 namespace vpp
 {
 
@@ -30,7 +32,7 @@ void Framebuffer::create(const Device& dev, const vk::Extent2D& size,
 	const AttachmentsInfo& attachments)
 {
 	std::vector<vk::ImageCreateInfo> info;
-	info.resize(attachments.size());
+	info.reserve(attachments.size());
 	for(auto& at : attachments) info.push_back(at.imgInfo);
 
 	create(dev, size, info);
@@ -46,8 +48,11 @@ void Framebuffer::create(const Device& dev, const vk::Extent2D& size,
 	attachments_.reserve(imgInfo.size());
 	for(auto& attinfo : imgInfo)
 	{
+		//attachments may be larger than the framebuffer, which allows to resize it
 		auto imageInfo = attinfo;
-		imageInfo.extent = {size.width, size.height, 1};
+		imageInfo.extent.width = std::max(size.width, attinfo.extent.width);
+		imageInfo.extent.height = std::max(size.height, attinfo.extent.height);
+		imageInfo.extent.depth = 1;
 
 		attachments_.emplace_back();
 		attachments_.back().create(device(), imageInfo);
@@ -58,7 +63,7 @@ void Framebuffer::init(vk::RenderPass rp, const AttachmentsInfo& attachments,
 	const ExtAttachments& extAttachments)
 {
 	std::vector<vk::ImageViewCreateInfo> info;
-	info.resize(attachments.size());
+	info.reserve(attachments.size());
 	for(auto& at : attachments) info.push_back(at.viewInfo);
 
 	init(rp, info, extAttachments);
@@ -71,7 +76,22 @@ void Framebuffer::init(vk::RenderPass rp, const std::vector<vk::ImageViewCreateI
 		throw std::logic_error("vpp::Framebuffer::init: to few viewInfos");
 
 	for(std::size_t i(0); i < attachments_.size(); ++i) attachments_[i].init(viewInfo[i]);
+	createHandle(rp, extAttachments);
+}
+
+void Framebuffer::resize(vk::RenderPass rp, const vk::Extent2D& size,
+	const ExtAttachments& extAttachments)
+{
+	if(vkHandle()) vk::destroyFramebuffer(vkDevice(), vkHandle(), nullptr);
+	vkHandle() = {};
 
+	width_ = size.width;
+	height_ = size.height;
+	createHandle(rp, extAttachments);
+}
+
+void Framebuffer::createHandle(vk::RenderPass rp, const ExtAttachments& extAttachments)
+{
 	//framebuffer
 	//attachments
 	std::vector<vk::ImageView> attachments;
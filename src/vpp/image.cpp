@@ -1,13 +1,19 @@
 #include <vpp/image.hpp>
+#include <vpp/convert.hpp>
 #include <vpp/provider.hpp>
 #include <vpp/transfer.hpp>
 #include <vpp/transferWork.hpp>
 #include <vpp/pipeline.hpp>
 #include <vpp/queue.hpp>
+#include <vpp/sync.hpp>
 #include <vpp/vk.hpp>
 #include <vpp/utility/debug.hpp>
 
 #include <utility>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
 
 namespace vpp
 {
@@ -16,13 +22,65 @@ namespace vpp
 namespace
 {
 
-vk::DeviceSize imageAddress(const vk::SubresourceLayout& layout, unsigned int texelSize,
-	unsigned int x, unsigned int y, unsigned int z, unsigned int layer)
+//Returns the address of the given texel block in a subresource.
+vk::DeviceSize imageAddress(const vk::SubresourceLayout& layout, unsigned int blockBytes,
+	unsigned int x, unsigned int y, unsigned int z)
 {
-	return layer * layout.arrayPitch + z * layout.depthPitch + y * layout.rowPitch +
-		x * texelSize + layout.offset;
+	return z * layout.depthPitch + y * layout.rowPitch + x * blockBytes + layout.offset;
 }
 
+//Copies the given data into the transfer range and makes it visible for the device.
+void writeStaging(const TransferRange& range, const std::uint8_t& data, std::size_t size)
+{
+	auto map = range.buffer().memoryMap();
+	std::memcpy(map.ptr() + range.offset(), &data, size);
+	if(!map.coherent()) map.flush();
+}
+
+//Copies the data of the given region between the mapped memory of a linear image
+//and the given data block. If toImage is false, the data is read from the image.
+void copyMapped(const Image& image, const MemoryMapView& map, std::uint8_t* data,
+	vk::Format format, const vk::BufferImageCopy& region, bool toImage)
+{
+	const auto& sub = region.imageSubresource;
+	const auto& extent = region.imageExtent;
+	const auto& offset = region.imageOffset;
+
+	//compressed formats are handled in rows of blocks
+	const auto block = blockSize(format);
+	const auto blockBytes = formatSize(format);
+	const auto rowSize = rowPitch(format, extent.width);
+	const auto rows = (extent.height + block.height - 1) / block.height;
+
+	//size of one row/slice in the data block
+	auto rowLength = region.bufferRowLength ? region.bufferRowLength : extent.width;
+	auto imageHeight = region.bufferImageHeight ? region.bufferImageHeight : extent.height;
+	auto dataRowSize = rowPitch(format, rowLength);
+	auto dataSliceSize = slicePitch(format, rowLength, imageHeight);
+
+	auto doffset = region.bufferOffset;
+	for(auto layer = sub.baseArrayLayer; layer < sub.baseArrayLayer + sub.layerCount; ++layer)
+	{
+		//the returned layout already includes the offset for the mip level and layer
+		vk::ImageSubresource subres {sub.aspectMask, sub.mipLevel, layer};
+		auto layout = vk::getImageSubresourceLayout(image.device(), image, subres);
+
+		for(auto d = 0u; d < extent.depth; ++d)
+		{
+			for(auto r = 0u; r < rows; ++r)
+			{
+				auto ioff = imageAddress(layout, blockBytes, offset.x / block.width,
+					offset.y / block.height + r, offset.z + d);
+				auto off = doffset + d * dataSliceSize + r * dataRowSize;
+
+				if(toImage) std::memcpy(map.ptr() + ioff, data + off, rowSize);
+				else std::memcpy(data + off, map.ptr() + ioff, rowSize);
+			}
+		}
+
+		doffset += extent.depth * dataSliceSize;
+	}
+}
 }
 
 //Image
@@ -69,26 +127,76 @@ WorkPtr fill(const Image& image, const std::uint8_t& data, vk::Format format,
 	vk::ImageLayout layout, const vk::Extent3D& extent, const vk::ImageSubresource& subres,
 	const vk::Offset3D& offset, bool allowMap)
 {
+	const auto byteSize = imageDataSize(format, extent);
+
+	vk::BufferImageCopy region;
+	region.imageOffset = offset;
+	region.imageExtent = extent;
+	region.imageSubresource = {subres.aspectMask, subres.mipLevel, subres.arrayLayer, 1};
+
+	return fill(image, Range<std::uint8_t>(data, byteSize), format, layout, {region}, allowMap);
+}
+
+WorkPtr fill(const Image& image, const Range<std::uint8_t>& data, vk::Format format,
+	vk::ImageLayout layout, const Range<vk::BufferImageCopy>& regions, bool allowMap)
+{
+	image.assureMemory();
+
+	if(image.mappable() && allowMap)
+	{
+		auto map = image.memoryMap();
+		auto ptr = const_cast<std::uint8_t*>(data.data());
+		for(auto& region : regions) copyMapped(image, map, ptr, format, region, true);
+
+		if(!map.coherent()) map.flush();
+		return std::make_unique<FinishedWork<void>>();
+	}
+	else
+	{
+		//stage everything at once
+		const Queue* queue;
+		auto qFam = transferQueueFamily(image.device(), &queue);
+		auto cmdBuffer = image.device().commandProvider().get(qFam);
+		auto uploadBuffer = image.device().transferManager().buffer(data.size());
+		writeStaging(uploadBuffer, *data.data(), data.size());
+
+		vk::beginCommandBuffer(cmdBuffer, {});
+		fillCommand(cmdBuffer, image, layout, uploadBuffer.buffer(), uploadBuffer.offset(),
+			regions);
+		vk::endCommandBuffer(cmdBuffer);
+
+		return std::make_unique<UploadWork>(std::move(cmdBuffer), *queue, std::move(uploadBuffer));
+	}
+}
+
+WorkPtr fill(const Image& image, const std::uint8_t& data, vk::Format srcFormat,
+	vk::Format dstFormat, vk::ImageLayout layout, const vk::Extent3D& extent,
+	const vk::ImageSubresource& subres, const vk::Offset3D& offset, bool allowMap)
+{
+	if(!texelConvertible(srcFormat, dstFormat))
+		throw std::logic_error("vpp::fill: the given formats are not convertible");
+
 	image.assureMemory();
-	const auto texSize = formatSize(format);
 
-	//TODO: correct offset/extent handling
+	const auto srcTexel = formatSize(srcFormat);
+	const auto rowTexels = extent.width;
+	const auto texels = std::size_t(extent.width) * extent.height * extent.depth;
+
 	if(image.mappable() && allowMap)
 	{
-		//baiscally the size of the format in bytes. Can be computed from the given size/extent.
-		auto sresLayout = vk::getImageSubresourceLayout(image.device(), image, subres);
-		auto map = image.memoryEntry().map();
+		//convert every row directly into the image memory
+		auto map = image.memoryMap();
+		auto subLayout = vk::getImageSubresourceLayout(image.device(), image, subres);
+		const auto dstTexel = formatSize(dstFormat);
 
-		//dataoffset
-		auto doffset = 0u;
-		for(unsigned int d = offset.z; d < offset.z + extent.depth; ++d)
+		auto src = &data;
+		for(auto d = 0u; d < extent.depth; ++d)
 		{
-			for(unsigned int h = offset.y; h < offset.y + extent.height; ++h)
+			for(auto r = 0u; r < extent.height; ++r)
 			{
-				//image offset
-				auto ioff = imageAddress(sresLayout, texSize, offset.x, h, d, subres.arrayLayer);
-				std::memcpy(map.ptr() + ioff, &data + doffset, texSize * extent.width);
-				doffset += extent.width * texSize;
+				auto ioff = imageAddress(subLayout, dstTexel, offset.x, offset.y + r, offset.z + d);
+				convertTexels(*src, srcFormat, *(map.ptr() + ioff), dstFormat, rowTexels);
+				src += rowTexels * srcTexel;
 			}
 		}
 
@@ -97,12 +205,18 @@ WorkPtr fill(const Image& image, const std::uint8_t& data, vk::Format format,
 	}
 	else
 	{
-		const auto byteSize = texSize * extent.width * extent.height * extent.depth;
+		//convert into the staging buffer
 		const Queue* queue;
 		auto qFam = transferQueueFamily(image.device(), &queue);
 		auto cmdBuffer = image.device().commandProvider().get(qFam);
-		auto uploadBuffer = image.device().transferManager().buffer(byteSize);
-		fill140(uploadBuffer.buffer(), raw(data, byteSize));
+		auto uploadBuffer = image.device().transferManager().buffer(
+			imageDataSize(dstFormat, extent));
+
+		{
+			auto map = uploadBuffer.buffer().memoryMap();
+			convertTexels(data, srcFormat, *(map.ptr() + uploadBuffer.offset()), dstFormat, texels);
+			if(!map.coherent()) map.flush();
+		}
 
 		vk::BufferImageCopy region;
 		region.imageOffset = offset;
@@ -110,19 +224,51 @@ WorkPtr fill(const Image& image, const std::uint8_t& data, vk::Format format,
 		region.imageSubresource = {subres.aspectMask, subres.mipLevel, subres.arrayLayer, 1};
 
 		vk::beginCommandBuffer(cmdBuffer, {});
-
-		//change layout if needed
-		if(layout != vk::ImageLayout::transferDstOptimal && layout != vk::ImageLayout::general)
-			changeLayoutCommand(cmdBuffer, image, layout, vk::ImageLayout::transferDstOptimal,
-				subres.aspectMask);
-
-		vk::cmdCopyBufferToImage(cmdBuffer, uploadBuffer.buffer(), image, layout, {region});
+		fillCommand(cmdBuffer, image, layout, uploadBuffer.buffer(), uploadBuffer.offset(),
+			{region});
 		vk::endCommandBuffer(cmdBuffer);
 
 		return std::make_unique<UploadWork>(std::move(cmdBuffer), *queue, std::move(uploadBuffer));
 	}
 }
 
+WorkPtr fillMipmapped(const Image& image, const std::uint8_t& data, vk::Format format,
+	vk::ImageLayout layout, const vk::Extent3D& extent, unsigned int levels,
+	vk::ImageLayout finalLayout, vk::ImageAspectFlags aspect)
+{
+	auto& dev = image.device();
+	if(!levels) throw std::logic_error("vpp::fillMipmapped: levels must not be 0");
+
+	//checked before anything is recorded
+	auto filter = mipmapFilter(dev, format);
+	image.assureMemory();
+
+	//blitting requires a graphics queue
+	auto queue = dev.queue(vk::QueueBits::graphics);
+	if(!queue) throw std::runtime_error("vpp::fillMipmapped: device has no graphics queue");
+
+	const auto byteSize = imageDataSize(format, extent);
+	auto cmdBuffer = dev.commandProvider().get(queue->family());
+	auto uploadBuffer = dev.transferManager().buffer(byteSize);
+	writeStaging(uploadBuffer, data, byteSize);
+
+	vk::BufferImageCopy region;
+	region.imageExtent = extent;
+	region.imageSubresource = {aspect, 0, 0, 1};
+
+	vk::beginCommandBuffer(cmdBuffer, {});
+	fillCommand(cmdBuffer, image, layout, uploadBuffer.buffer(), uploadBuffer.offset(),
+		{region});
+
+	auto baseLayout = (layout == vk::ImageLayout::general) ? layout :
+		vk::ImageLayout::transferDstOptimal;
+	generateMipmapsCommand(cmdBuffer, image, extent, levels, baseLayout, finalLayout, 1, aspect,
+		filter);
+	vk::endCommandBuffer(cmdBuffer);
+
+	return std::make_unique<UploadWork>(std::move(cmdBuffer), *queue, std::move(uploadBuffer));
+}
+
 DataWorkPtr retrieve(const Image& image, vk::ImageLayout layout, vk::Format format,
 	const vk::Extent3D& extent, const vk::ImageSubresource& subres, const vk::Offset3D& offset,
 	bool allowMap)
@@ -137,28 +283,20 @@ DataWorkPtr retrieve(const Image& image, vk::ImageLayout layout, vk::Format form
 		}
 	});
 
+	vk::BufferImageCopy region;
+	region.imageOffset = offset;
+	region.imageExtent = extent;
+	region.imageSubresource = {subres.aspectMask, subres.mipLevel, subres.arrayLayer, 1};
+
+	const auto byteSize = imageDataSize(format, extent);
+
 	if(image.mappable() && allowMap)
 	{
-		std::vector<std::uint8_t> data(image.size());
+		std::vector<std::uint8_t> data(byteSize);
 		auto map = image.memoryMap();
+		if(!map.coherent()) map.reload();
 
-		//baiscally the size of the format in bytes. Can be computed from the given size/extent.
-		const auto texelSize = formatSize(format);
-		auto subresLayout = vk::getImageSubresourceLayout(image.device(), image, subres);
-
-		//dataOffset
-		auto doffset = 0u;
-		for(unsigned int d = offset.z; d < offset.z + extent.depth; ++d)
-		{
-			for(unsigned int h = offset.y; h < offset.y + extent.height; ++h)
-			{
-				//image offset
-				auto ioffset = imageAddress(subresLayout, texelSize, 0, h, d, subres.arrayLayer);
-				std::memcpy(data.data() + doffset, map.ptr() + ioffset, extent.width);
-				doffset += extent.width;
-			}
-		}
-
+		copyMapped(image, map, data.data(), format, region, false);
 		return std::make_unique<StoredDataWork>(std::move(data));
 	}
 	else
@@ -166,89 +304,240 @@ DataWorkPtr retrieve(const Image& image, vk::ImageLayout layout, vk::Format form
 		const Queue* queue;
 		auto qFam = transferQueueFamily(image.device(), &queue);
 		auto cmdBuffer = image.device().commandProvider().get(qFam);
-		auto downloadBuffer = image.device().transferManager().buffer(image.size());
+		auto downloadBuffer = image.device().transferManager().buffer(byteSize);
 
 		vk::beginCommandBuffer(cmdBuffer, {});
 
-		//change layout if needed
+		//change layout if needed, a single transition of the copied subresource
+		//(see fillCommand why no ResourceStateTracker is used)
 		if(layout != vk::ImageLayout::transferSrcOptimal && layout != vk::ImageLayout::general)
+		{
 			changeLayoutCommand(cmdBuffer, image, layout, vk::ImageLayout::transferSrcOptimal,
-				subres.aspectMask);
-
-		vk::BufferImageCopy region;
-		region.imageOffset = offset;
-		region.imageExtent = extent;
-		region.imageSubresource = {subres.aspectMask, subres.mipLevel, subres.arrayLayer, 1};
+				{subres.aspectMask, subres.mipLevel, 1, subres.arrayLayer, 1});
+			layout = vk::ImageLayout::transferSrcOptimal;
+		}
 
+		region.bufferOffset = downloadBuffer.offset();
 		vk::cmdCopyImageToBuffer(cmdBuffer, image, layout, downloadBuffer.buffer(), {region});
 		vk::endCommandBuffer(cmdBuffer);
 
-		vk::endCommandBuffer(cmdBuffer);
 		return std::make_unique<DownloadWork>(std::move(cmdBuffer), *queue,
 			std::move(downloadBuffer));
 	}
 }
 
 //free utility functions
-void changeLayoutCommand(vk::CommandBuffer cmdBuffer, vk::Image img, vk::ImageLayout ol,
-	vk::ImageLayout nl, vk::ImageAspectFlags aspect)
+void fillCommand(vk::CommandBuffer cmdBuffer, vk::Image image, vk::ImageLayout layout,
+	vk::Buffer buffer, vk::DeviceSize offset, const Range<vk::BufferImageCopy>& regions)
 {
-	vk::ImageMemoryBarrier barrier;
-	barrier.oldLayout = ol;
-	barrier.newLayout = nl;
-	barrier.image = img;
-	barrier.subresourceRange = {aspect, 0, 1, 0, 1};
+	//change layout if needed.
+	//This is the only barrier recorded here (the copy depends on nothing else) and the
+	//previous uses of the image are unknown, so a ResourceStateTracker could not merge
+	//or elide anything and a single transition of the covered range is recorded directly
+	if(layout != vk::ImageLayout::transferDstOptimal && layout != vk::ImageLayout::general)
+	{
+		changeLayoutCommand(cmdBuffer, image, layout, vk::ImageLayout::transferDstOptimal,
+			subresourceRange(regions));
+		layout = vk::ImageLayout::transferDstOptimal;
+	}
+
+	std::vector<vk::BufferImageCopy> copies(regions.begin(), regions.end());
+	for(auto& copy : copies) copy.bufferOffset += offset;
+	vk::cmdCopyBufferToImage(cmdBuffer, buffer, image, layout, copies);
+}
+
+std::size_t rowPitch(vk::Format format, unsigned int width)
+{
+	auto block = blockSize(format);
+	if(!block.width) return 0u;
+	return ((width + block.width - 1) / block.width) * formatSize(format);
+}
+
+std::size_t slicePitch(vk::Format format, unsigned int width, unsigned int height)
+{
+	auto block = blockSize(format);
+	if(!block.height) return 0u;
+	return ((height + block.height - 1) / block.height) * rowPitch(format, width);
+}
+
+std::size_t imageDataSize(vk::Format format, const vk::Extent3D& extent)
+{
+	return extent.depth * slicePitch(format, extent.width, extent.height);
+}
+
+vk::ImageSubresourceRange subresourceRange(const Range<vk::BufferImageCopy>& regions)
+{
+	if(regions.empty()) return {};
+
+	auto minLevel = ~0u, maxLevel = 0u;
+	auto minLayer = ~0u, maxLayer = 0u;
+	vk::ImageAspectFlags aspects {};
 
-	switch(ol)
+	for(auto& region : regions)
 	{
-	case vk::ImageLayout::undefined:
-		barrier.srcAccessMask = {}; break;
-	case vk::ImageLayout::preinitialized:
-		barrier.srcAccessMask = vk::AccessBits::hostWrite; break;
-	case vk::ImageLayout::colorAttachmentOptimal:
-		barrier.srcAccessMask = vk::AccessBits::colorAttachmentWrite; break;
-	case vk::ImageLayout::depthStencilAttachmentOptimal:
-		barrier.srcAccessMask = vk::AccessBits::depthStencilAttachmentWrite; break;
-	case vk::ImageLayout::transferSrcOptimal:
-		barrier.srcAccessMask = vk::AccessBits::transferRead; break;
-	case vk::ImageLayout::transferDstOptimal:
-		barrier.srcAccessMask = vk::AccessBits::transferWrite; break;
-	case vk::ImageLayout::shaderReadOnlyOptimal:
-		barrier.srcAccessMask = vk::AccessBits::shaderRead; break;
-	default: break;
+		const auto& sub = region.imageSubresource;
+		aspects |= sub.aspectMask;
+		minLevel = std::min(minLevel, sub.mipLevel);
+		maxLevel = std::max(maxLevel, sub.mipLevel);
+		minLayer = std::min(minLayer, sub.baseArrayLayer);
+		maxLayer = std::max(maxLayer, sub.baseArrayLayer + sub.layerCount - 1);
 	}
 
-	switch(nl)
+	return {aspects, minLevel, maxLevel - minLevel + 1, minLayer, maxLayer - minLayer + 1};
+}
+
+unsigned int mipmapLevels(const vk::Extent3D& extent)
+{
+	auto size = std::max(std::max(extent.width, extent.height), extent.depth);
+
+	auto levels = 1u;
+	while(size >>= 1) ++levels;
+	return levels;
+}
+
+vk::Filter mipmapFilter(const Device& dev, vk::Format format)
+{
+	auto props = vk::getPhysicalDeviceFormatProperties(dev.vkPhysicalDevice(), format);
+	auto& features = props.optimalTilingFeatures;
+	if(!(features & vk::FormatFeatureBits::blitSrc) || !(features & vk::FormatFeatureBits::blitDst))
+		throw std::logic_error("vpp::mipmapFilter: format does not support blitting");
+
+	if(features & vk::FormatFeatureBits::sampledImageFilterLinear)
+		return vk::Filter::linear;
+
+	return vk::Filter::nearest;
+}
+
+void generateMipmapsCommand(vk::CommandBuffer cmdBuffer, vk::Image image,
+	const vk::Extent3D& extent, unsigned int levels, vk::ImageLayout baseLayout,
+	vk::ImageLayout finalLayout, unsigned int layers, vk::ImageAspectFlags aspect,
+	vk::Filter filter)
+{
+	if(!levels) throw std::logic_error("vpp::generateMipmapsCommand: levels must not be 0");
+	if(!layers) throw std::logic_error("vpp::generateMipmapsCommand: layers must not be 0");
+
+	const auto transfer = vk::PipelineStageBits::transfer;
+
+	vk::ImageMemoryBarrier barrier;
+	barrier.image = image;
+
+	//the base level must be readable, all other levels are discarded and written
+	barrier.subresourceRange = {aspect, 0, 1, 0, layers};
+	barrier.oldLayout = baseLayout;
+	barrier.newLayout = vk::ImageLayout::transferSrcOptimal;
+	barrier.srcAccessMask = vk::AccessBits::transferWrite;
+	barrier.dstAccessMask = vk::AccessBits::transferRead;
+
+	auto dstBarrier = barrier;
+	dstBarrier.subresourceRange = {aspect, 1, levels - 1, 0, layers};
+	dstBarrier.oldLayout = vk::ImageLayout::undefined;
+	dstBarrier.newLayout = vk::ImageLayout::transferDstOptimal;
+	dstBarrier.srcAccessMask = {};
+	dstBarrier.dstAccessMask = vk::AccessBits::transferWrite;
+
+	if(levels > 1) vk::cmdPipelineBarrier(cmdBuffer, transfer, transfer, {}, {}, {},
+		{barrier, dstBarrier});
+	else vk::cmdPipelineBarrier(cmdBuffer, transfer, transfer, {}, {}, {}, {barrier});
+
+	//blit every level from the previous one and make it a source for the next one
+	vk::Offset3D size {int(extent.width), int(extent.height), int(extent.depth)};
+	barrier.oldLayout = vk::ImageLayout::transferDstOptimal;
+	barrier.srcAccessMask = vk::AccessBits::transferWrite;
+
+	for(auto i = 1u; i < levels; ++i)
 	{
-	case vk::ImageLayout::transferDstOptimal:
-		barrier.dstAccessMask = vk::AccessBits::transferWrite; break;
-		break;
+		vk::Offset3D next {std::max(size.x / 2, 1), std::max(size.y / 2, 1),
+			std::max(size.z / 2, 1)};
 
-	case vk::ImageLayout::transferSrcOptimal:
-		barrier.srcAccessMask |= vk::AccessBits::transferRead;
-		barrier.dstAccessMask = vk::AccessBits::transferRead;
-		break;
+		vk::ImageBlit blit;
+		blit.srcSubresource = {aspect, i - 1, 0, layers};
+		blit.srcOffsets[1] = size;
+		blit.dstSubresource = {aspect, i, 0, layers};
+		blit.dstOffsets[1] = next;
 
-	case vk::ImageLayout::colorAttachmentOptimal:
-		barrier.srcAccessMask = vk::AccessBits::transferRead;
-		barrier.dstAccessMask = vk::AccessBits::colorAttachmentWrite;
-		break;
+		vk::cmdBlitImage(cmdBuffer, image, vk::ImageLayout::transferSrcOptimal, image,
+			vk::ImageLayout::transferDstOptimal, {blit}, filter);
 
-	case vk::ImageLayout::depthStencilAttachmentOptimal:
-		barrier.dstAccessMask |= vk::AccessBits::depthStencilAttachmentWrite;
-		break;
+		barrier.subresourceRange.baseMipLevel = i;
+		vk::cmdPipelineBarrier(cmdBuffer, transfer, transfer, {}, {}, {}, {barrier});
 
+		size = next;
+	}
+
+	//all levels are now in transferSrcOptimal layout
+	if(finalLayout == vk::ImageLayout::transferSrcOptimal) return;
+
+	barrier.subresourceRange = {aspect, 0, levels, 0, layers};
+	barrier.oldLayout = vk::ImageLayout::transferSrcOptimal;
+	barrier.newLayout = finalLayout;
+	barrier.srcAccessMask = vk::AccessBits::transferRead;
+
+	switch(finalLayout)
+	{
 	case vk::ImageLayout::shaderReadOnlyOptimal:
-		if(!barrier.srcAccessMask)
-			barrier.srcAccessMask = vk::AccessBits::hostWrite | vk::AccessBits::transferWrite;
-		barrier.dstAccessMask = vk::AccessBits::shaderRead;
+		barrier.dstAccessMask = vk::AccessBits::shaderRead; break;
+	case vk::ImageLayout::transferDstOptimal:
+		barrier.dstAccessMask = vk::AccessBits::transferWrite; break;
+	case vk::ImageLayout::colorAttachmentOptimal:
+		barrier.dstAccessMask = vk::AccessBits::colorAttachmentRead |
+			vk::AccessBits::colorAttachmentWrite;
 		break;
-	
-	default: break;
+	default:
+		barrier.dstAccessMask = vk::AccessBits::memoryRead | vk::AccessBits::memoryWrite; break;
 	}
 
-	const auto stage = vk::PipelineStageBits::topOfPipe;
-	vk::cmdPipelineBarrier(cmdBuffer, stage, stage, {}, {}, {}, {barrier});
+	vk::cmdPipelineBarrier(cmdBuffer, transfer, vk::PipelineStageBits::allCommands, {}, {}, {},
+		{barrier});
+}
+
+WorkPtr generateMipmaps(const Image& image, vk::Format format, const vk::Extent3D& extent,
+	unsigned int levels, vk::ImageLayout baseLayout, vk::ImageLayout finalLayout,
+	unsigned int layers, vk::ImageAspectFlags aspect)
+{
+	auto& dev = image.device();
+	auto queue = dev.queue(vk::QueueBits::graphics);
+	if(!queue) throw std::runtime_error("vpp::generateMipmaps: device has no graphics queue");
+
+	auto filter = mipmapFilter(dev, format);
+	auto cmdBuffer = dev.commandProvider().get(queue->family());
+	vk::beginCommandBuffer(cmdBuffer, {});
+	generateMipmapsCommand(cmdBuffer, image, extent, levels, baseLayout, finalLayout, layers,
+		aspect, filter);
+	vk::endCommandBuffer(cmdBuffer);
+
+	return std::make_unique<CommandWork<void>>(std::move(cmdBuffer), *queue);
+}
+
+void changeLayoutCommand(vk::CommandBuffer cmdBuffer, vk::Image img, vk::ImageLayout ol,
+	vk::ImageLayout nl, vk::ImageAspectFlags aspect, vk::QueueFlags queueFlags)
+{
+	changeLayoutCommand(cmdBuffer, img, ol, nl, {aspect, 0, 1, 0, 1}, queueFlags);
+}
+
+void changeLayoutCommand(vk::CommandBuffer cmdBuffer, vk::Image img, vk::ImageLayout ol,
+	vk::ImageLayout nl, const vk::ImageSubresourceRange& range, vk::QueueFlags queueFlags)
+{
+	//only the writes of the old layout must be made available, the new layout determines
+	//which accesses and stages have to wait for the transition
+	auto srcAccess = layoutAccess(ol);
+	auto dstAccess = layoutAccess(nl);
+
+	vk::ImageMemoryBarrier barrier;
+	barrier.oldLayout = ol;
+	barrier.newLayout = nl;
+	barrier.srcAccessMask = writeAccess(srcAccess);
+	barrier.dstAccessMask = dstAccess;
+	barrier.srcQueueFamilyIndex = vk::queueFamilyIgnored;
+	barrier.dstQueueFamilyIndex = vk::queueFamilyIgnored;
+	barrier.image = img;
+	barrier.subresourceRange = range;
+
+	auto srcStages = accessStages(srcAccess, queueFlags);
+	auto dstStages = accessStages(dstAccess, queueFlags);
+	if(!srcStages) srcStages = vk::PipelineStageBits::topOfPipe;
+	if(!dstStages) dstStages = vk::PipelineStageBits::bottomOfPipe;
+
+	vk::cmdPipelineBarrier(cmdBuffer, srcStages, dstStages, {}, {}, {}, {barrier});
 }
 
 WorkPtr changeLayout(const Device& dev, vk::Image img, vk::ImageLayout ol, vk::ImageLayout nl,
@@ -259,7 +548,8 @@ WorkPtr changeLayout(const Device& dev, vk::Image img, vk::ImageLayout ol, vk::I
 
 	auto cmdBuffer = dev.commandProvider().get(qFam);
 	vk::beginCommandBuffer(cmdBuffer, {});
-	changeLayoutCommand(cmdBuffer, img, ol, nl, aspect);
+	changeLayoutCommand(cmdBuffer, img, ol, nl, aspect,
+		dev.queueFamilyProperties(qFam).queueFlags);
 	vk::endCommandBuffer(cmdBuffer);
 
 	return std::make_unique<CommandWork<void>>(std::move(cmdBuffer), *queue);
@@ -294,6 +584,23 @@ ViewableImage::CreateInfo ViewableImage::defaultColor2D()
 	};
 }
 
+ViewableImage::CreateInfo ViewableImage::defaultTexture2D(const vk::Extent2D& size,
+	vk::Format format, bool mipmaps)
+{
+	auto info = defaultColor2D();
+	auto levels = mipmaps ? mipmapLevels({size.width, size.height, 1}) : 1u;
+
+	info.imgInfo.format = format;
+	info.imgInfo.extent = {size.width, size.height, 1};
+	info.imgInfo.mipLevels = levels;
+	info.imgInfo.usage = vk::ImageUsageBits::sampled | vk::ImageUsageBits::transferDst;
+	if(mipmaps) info.imgInfo.usage |= vk::ImageUsageBits::transferSrc;
+
+	info.viewInfo.format = format;
+	info.viewInfo.subresourceRange.levelCount = levels;
+	return info;
+}
+
 ViewableImage::CreateInfo ViewableImage::defaultDepth2D()
 {
 	return {
@@ -539,7 +846,7 @@ unsigned int formatSizeBits(vk::Format format)
 	    case Format::etc2R8g8b8a1UnormBlock: return 64;
 	    case Format::etc2R8g8b8a1SrgbBlock: return 64;
 	    case Format::etc2R8g8b8a8UnormBlock: return 128;
-	    case Format::etc2R8g8b8a8SrgbBlock: return 64;
+	    case Format::etc2R8g8b8a8SrgbBlock: return 128;
 	    case Format::eacR11UnormBlock: return 64;
 	    case Format::eacR11SnormBlock: return 64;
 	    case Format::eacR11g11UnormBlock: return 128;
@@ -0,0 +1,340 @@
+#include <vpp/ktx.hpp>
+#include <vpp/transfer.hpp>
+#include <vpp/transferWork.hpp>
+#include <vpp/queue.hpp>
+#include <vpp/vk.hpp>
+#include <vpp/utility/debug.hpp>
+
+#include <istream>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <cstring>
+
+namespace vpp
+{
+
+//utility
+namespace
+{
+
+constexpr std::uint8_t ktxIdentifier[12] =
+	{0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+//the header fields following the identifier
+struct KtxHeader
+{
+	std::uint32_t endianness;
+	std::uint32_t glType;
+	std::uint32_t glTypeSize;
+	std::uint32_t glFormat;
+	std::uint32_t glInternalFormat;
+	std::uint32_t glBaseInternalFormat;
+	std::uint32_t pixelWidth;
+	std::uint32_t pixelHeight;
+	std::uint32_t pixelDepth;
+	std::uint32_t numberOfArrayElements;
+	std::uint32_t numberOfFaces;
+	std::uint32_t numberOfMipmapLevels;
+	std::uint32_t bytesOfKeyValueData;
+};
+
+std::uint32_t swapEndian(std::uint32_t val)
+{
+	return ((val & 0xFF) << 24) | ((val & 0xFF00) << 8) | ((val >> 8) & 0xFF00) | (val >> 24);
+}
+
+//Returns the vulkan format for a gl internal format or vk::Format::undefined.
+vk::Format vulkanFormat(std::uint32_t glFormat)
+{
+	using vk::Format;
+
+	switch(glFormat)
+	{
+		//uncompressed
+		case 0x8229: return Format::r8Unorm; //GL_R8
+		case 0x822B: return Format::r8g8Unorm; //GL_RG8
+		case 0x8051: return Format::r8g8b8Unorm; //GL_RGB8
+		case 0x8058: return Format::r8g8b8a8Unorm; //GL_RGBA8
+		case 0x8C41: return Format::r8g8b8Srgb; //GL_SRGB8
+		case 0x8C43: return Format::r8g8b8a8Srgb; //GL_SRGB8_ALPHA8
+		case 0x93A1: return Format::b8g8r8a8Unorm; //GL_BGRA8_EXT
+		case 0x822D: return Format::r16Sfloat; //GL_R16F
+		case 0x822F: return Format::r16g16Sfloat; //GL_RG16F
+		case 0x881A: return Format::r16g16b16a16Sfloat; //GL_RGBA16F
+		case 0x822E: return Format::r32Sfloat; //GL_R32F
+		case 0x8230: return Format::r32g32Sfloat; //GL_RG32F
+		case 0x8814: return Format::r32g32b32a32Sfloat; //GL_RGBA32F
+
+		//s3tc
+		case 0x83F0: return Format::bc1RgbUnormBlock;
+		case 0x83F1: return Format::bc1RgbaUnormBlock;
+		case 0x83F2: return Format::bc2UnormBlock;
+		case 0x83F3: return Format::bc3UnormBlock;
+		case 0x8C4C: return Format::bc1RgbSrgbBlock;
+		case 0x8C4D: return Format::bc1RgbaSrgbBlock;
+		case 0x8C4E: return Format::bc2SrgbBlock;
+		case 0x8C4F: return Format::bc3SrgbBlock;
+
+		//rgtc
+		case 0x8DBB: return Format::bc4UnormBlock;
+		case 0x8DBC: return Format::bc4SnormBlock;
+		case 0x8DBD: return Format::bc5UnormBlock;
+		case 0x8DBE: return Format::bc5SnormBlock;
+
+		//bptc
+		case 0x8E8C: return Format::bc7UnormBlock;
+		case 0x8E8D: return Format::bc7SrgbBlock;
+		case 0x8E8E: return Format::bc6hSfloatBlock;
+		case 0x8E8F: return Format::bc6hUfloatBlock;
+
+		//etc2 and eac
+		case 0x9270: return Format::eacR11UnormBlock;
+		case 0x9271: return Format::eacR11SnormBlock;
+		case 0x9272: return Format::eacR11g11UnormBlock;
+		case 0x9273: return Format::eacR11g11SnormBlock;
+		case 0x9274: return Format::etc2R8g8b8UnormBlock;
+		case 0x9275: return Format::etc2R8g8b8SrgbBlock;
+		case 0x9276: return Format::etc2R8g8b8a1UnormBlock;
+		case 0x9277: return Format::etc2R8g8b8a1SrgbBlock;
+		case 0x9278: return Format::etc2R8g8b8a8UnormBlock;
+		case 0x9279: return Format::etc2R8g8b8a8SrgbBlock;
+
+		//astc
+		case 0x93B0: return Format::astc4x4UnormBlock;
+		case 0x93B1: return Format::astc5x4UnormBlock;
+		case 0x93B2: return Format::astc5x5UnormBlock;
+		case 0x93B3: return Format::astc6x5UnormBlock;
+		case 0x93B4: return Format::astc6x6UnormBlock;
+		case 0x93B5: return Format::astc8x5UnormBlock;
+		case 0x93B6: return Format::astc8x6UnormBlock;
+		case 0x93B7: return Format::astc8x8UnormBlock;
+		case 0x93B8: return Format::astc10x5UnormBlock;
+		case 0x93B9: return Format::astc10x6UnormBlock;
+		case 0x93BA: return Format::astc10x8UnormBlock;
+		case 0x93BB: return Format::astc10x10UnormBlock;
+		case 0x93BC: return Format::astc12x10UnormBlock;
+		case 0x93BD: return Format::astc12x12UnormBlock;
+		case 0x93D0: return Format::astc4x4SrgbBlock;
+		case 0x93D1: return Format::astc5x4SrgbBlock;
+		case 0x93D2: return Format::astc5x5SrgbBlock;
+		case 0x93D3: return Format::astc6x5SrgbBlock;
+		case 0x93D4: return Format::astc6x6SrgbBlock;
+		case 0x93D5: return Format::astc8x5SrgbBlock;
+		case 0x93D6: return Format::astc8x6SrgbBlock;
+		case 0x93D7: return Format::astc8x8SrgbBlock;
+		case 0x93D8: return Format::astc10x5SrgbBlock;
+		case 0x93D9: return Format::astc10x6SrgbBlock;
+		case 0x93DA: return Format::astc10x8SrgbBlock;
+		case 0x93DB: return Format::astc10x10SrgbBlock;
+		case 0x93DC: return Format::astc12x10SrgbBlock;
+		case 0x93DD: return Format::astc12x12SrgbBlock;
+
+		default: return Format::undefined;
+	}
+}
+
+vk::Extent3D levelExtent(const vk::Extent3D& extent, unsigned int level)
+{
+	return {std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u),
+		std::max(extent.depth >> level, 1u)};
+}
+
+//Reads exactly size bytes from the stream or throws.
+void readData(std::istream& stream, std::uint8_t* data, std::size_t size)
+{
+	if(!stream.read(reinterpret_cast<char*>(data), size))
+		throw std::runtime_error("vpp::fillKtx: unexpected end of texture data");
+}
+
+}
+
+//KtxInfo
+std::size_t KtxInfo::dataSize() const
+{
+	std::size_t ret = 0u;
+	for(auto i = 0u; i < levels; ++i)
+		ret += imageDataSize(format, levelExtent(extent, i)) * imageLayers();
+
+	return ret;
+}
+
+ViewableImage::CreateInfo KtxInfo::createInfo() const
+{
+	auto info = ViewableImage::defaultColor2D();
+	auto& img = info.imgInfo;
+	auto& view = info.viewInfo;
+
+	img.format = format;
+	img.extent = extent;
+	img.mipLevels = levels;
+	img.arrayLayers = imageLayers();
+	img.usage = vk::ImageUsageBits::sampled | vk::ImageUsageBits::transferDst;
+
+	view.format = format;
+	view.subresourceRange.levelCount = levels;
+	view.subresourceRange.layerCount = imageLayers();
+
+	if(dimensions == 1)
+	{
+		img.imageType = vk::ImageType::e1d;
+		view.viewType = array ? vk::ImageViewType::e1dArray : vk::ImageViewType::e1d;
+	}
+	else if(dimensions == 3)
+	{
+		img.imageType = vk::ImageType::e3d;
+		view.viewType = vk::ImageViewType::e3d;
+	}
+	else if(faces == 6)
+	{
+		img.flags = vk::ImageCreateBits::cubeCompatible;
+		view.viewType = array ? vk::ImageViewType::cubeArray : vk::ImageViewType::cube;
+	}
+	else
+	{
+		view.viewType = array ? vk::ImageViewType::e2dArray : vk::ImageViewType::e2d;
+	}
+
+	return info;
+}
+
+//functions
+KtxInfo readKtxHeader(std::istream& stream)
+{
+	std::uint8_t identifier[12];
+	KtxHeader header;
+
+	if(!stream.read(reinterpret_cast<char*>(identifier), sizeof(identifier)) ||
+		std::memcmp(identifier, ktxIdentifier, sizeof(identifier)))
+		throw std::runtime_error("vpp::readKtxHeader: invalid ktx identifier");
+
+	if(!stream.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		throw std::runtime_error("vpp::readKtxHeader: stream too small for header");
+
+	KtxInfo info;
+	if(header.endianness == 0x01020304)
+	{
+		info.swapEndian = true;
+		auto fields = reinterpret_cast<std::uint32_t*>(&header);
+		for(auto i = 0u; i < sizeof(header) / 4; ++i) fields[i] = swapEndian(fields[i]);
+	}
+	else if(header.endianness != 0x04030201)
+	{
+		throw std::runtime_error("vpp::readKtxHeader: invalid endianness");
+	}
+
+	//the data of types with more than one byte would have to be swapped
+	if(info.swapEndian && header.glTypeSize > 1)
+		throw std::runtime_error("vpp::readKtxHeader: data with swapped endianess unsupported");
+
+	info.format = vulkanFormat(header.glInternalFormat);
+	if(info.format == vk::Format::undefined)
+		throw std::runtime_error("vpp::readKtxHeader: unsupported format " +
+			std::to_string(header.glInternalFormat));
+
+	info.extent.width = header.pixelWidth;
+	info.extent.height = std::max(header.pixelHeight, 1u);
+	info.extent.depth = std::max(header.pixelDepth, 1u);
+	info.dimensions = header.pixelDepth ? 3 : header.pixelHeight ? 2 : 1;
+	info.levels = std::max(header.numberOfMipmapLevels, 1u);
+	info.layers = std::max(header.numberOfArrayElements, 1u);
+	info.faces = header.numberOfFaces;
+	info.array = header.numberOfArrayElements;
+
+	if(!info.extent.width || (info.faces != 1 && info.faces != 6))
+		throw std::runtime_error("vpp::readKtxHeader: invalid texture dimensions");
+
+	stream.ignore(header.bytesOfKeyValueData);
+	return info;
+}
+
+WorkPtr fillKtx(const Image& image, std::istream& stream, const KtxInfo& info,
+	vk::ImageLayout layout)
+{
+	auto& dev = image.device();
+	image.assureMemory();
+
+	const Queue* queue;
+	auto qFam = transferQueueFamily(dev, &queue);
+	auto cmdBuffer = dev.commandProvider().get(qFam);
+	auto uploadBuffer = dev.transferManager().buffer(info.dataSize());
+	auto map = uploadBuffer.buffer().memoryMap();
+
+	std::vector<vk::BufferImageCopy> regions;
+	regions.reserve(info.levels);
+
+	//for non-array cubemaps the size and padding is given for every face
+	const auto cubeFaces = (info.faces == 6 && !info.array);
+	const auto blockHeight = blockSize(info.format).height;
+	std::size_t offset = 0u;
+
+	for(auto i = 0u; i < info.levels; ++i)
+	{
+		std::uint32_t imageSize;
+		readData(stream, reinterpret_cast<std::uint8_t*>(&imageSize), sizeof(imageSize));
+		if(info.swapEndian) imageSize = swapEndian(imageSize);
+
+		auto extent = levelExtent(info.extent, i);
+		auto rowSize = rowPitch(info.format, extent.width);
+		auto rows = extent.depth * ((extent.height + blockHeight - 1) / blockHeight);
+
+		//rows of uncompressed data are aligned to 4 bytes (GL_UNPACK_ALIGNMENT)
+		auto fileRowSize = (rowSize + 3) & ~std::size_t(3);
+		auto padding = (4 - imageSize % 4) % 4;
+
+		vk::BufferImageCopy region;
+		region.bufferOffset = offset;
+		region.imageSubresource = {vk::ImageAspectBits::color, i, 0, info.imageLayers()};
+		region.imageExtent = extent;
+		regions.push_back(region);
+
+		for(auto l = 0u; l < info.imageLayers(); ++l)
+		{
+			//read the data directly into the staging buffer
+			auto data = map.ptr() + uploadBuffer.offset() + offset;
+			if(fileRowSize == rowSize)
+			{
+				readData(stream, data, rows * rowSize);
+			}
+			else
+			{
+				for(auto r = 0u; r < rows; ++r)
+				{
+					readData(stream, data + r * rowSize, rowSize);
+					stream.ignore(fileRowSize - rowSize);
+				}
+			}
+
+			offset += rows * rowSize;
+			if(cubeFaces) stream.ignore(padding);
+		}
+
+		if(!cubeFaces) stream.ignore(padding);
+	}
+
+	if(!map.coherent()) map.flush();
+
+	vk::beginCommandBuffer(cmdBuffer, {});
+	fillCommand(cmdBuffer, image, layout, uploadBuffer.buffer(), uploadBuffer.offset(), regions);
+	vk::endCommandBuffer(cmdBuffer);
+
+	return std::make_unique<UploadWork>(std::move(cmdBuffer), *queue, std::move(uploadBuffer));
+}
+
+ViewableImage loadKtx(const Device& dev, const StringParam& path, WorkPtr& work,
+	KtxInfo* info)
+{
+	std::ifstream ifs(path, std::ios::binary);
+	if(!ifs.is_open()) throw std::runtime_error(std::string("vpp::loadKtx: couldnt open ") +
+		path.data());
+
+	auto ktxInfo = readKtxHeader(ifs);
+	ViewableImage image(dev, ktxInfo.createInfo());
+	work = fillKtx(image.image(), ifs, ktxInfo);
+
+	if(info) *info = ktxInfo;
+	return image;
+}
+
+}
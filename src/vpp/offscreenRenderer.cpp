@@ -0,0 +1,308 @@
+#include <vpp/offscreenRenderer.hpp>
+#include <vpp/frameTimings.hpp>
+#include <vpp/queue.hpp>
+#include <vpp/renderPass.hpp>
+#include <vpp/vk.hpp>
+
+#include <stdexcept>
+
+namespace vpp
+{
+
+OffscreenRenderer::OffscreenRenderer(const Device& dev, const CreateInfo& info,
+	RenderImpl builder) : Resource(dev), info_(info), renderImpl_(std::move(builder))
+{
+	if(!info.renderPass)
+		throw std::runtime_error("vpp::OffscreenRenderer: invalid renderPass");
+
+	if(!info.targets)
+		throw std::logic_error("vpp::OffscreenRenderer: there must be at least one target");
+
+	if(info.readbackAttachment >= int(info.attachments.size()))
+		throw std::logic_error("vpp::OffscreenRenderer: invalid readbackAttachment");
+
+	if(!renderImpl_)
+		throw std::logic_error("vpp::OffscreenRenderer: invalid renderer builder");
+
+	createTargets();
+
+	//the first rendered frame uses the first target
+	current_ = info_.targets - 1;
+
+	if(info_.timingFrames)
+		timings_ = std::make_unique<FrameTimings>(dev, info_.timingFrames, info_.targets,
+			info_.queueFamily);
+
+	renderImpl_->init(*this);
+	record();
+}
+
+OffscreenRenderer::~OffscreenRenderer()
+{
+	//the command buffers and framebuffers must not be in use anymore
+	waitTargets();
+	recycleTargets();
+}
+
+void OffscreenRenderer::createTargets()
+{
+	auto attachments = info_.attachments;
+	if(info_.readbackAttachment >= 0)
+	{
+		auto& readbackInfo = attachments[info_.readbackAttachment];
+		readbackInfo.imgInfo.usage |= vk::ImageUsageBits::transferSrc;
+
+		auto& range = readbackInfo.viewInfo.subresourceRange;
+		readbackRegion_ = {};
+		readbackRegion_.imageSubresource = {range.aspectMask, 0, 0, 1};
+		readbackRegion_.imageExtent = {info_.size.width, info_.size.height, 1};
+
+		auto size = std::size_t(info_.size.width) * info_.size.height *
+			formatSize(readbackInfo.imgInfo.format);
+		auto slots = info_.readbackSlots ? info_.readbackSlots : info_.targets + 2;
+		readback_ = ReadbackStream(device(), size, slots);
+		readbackFrames_.clear();
+		readbackCount_ = 0;
+	}
+
+	auto qFam = info_.queueFamily;
+	auto flags = vk::CommandPoolCreateBits::resetCommandBuffer;
+	auto cmdBuffers = device().commandProvider().get(qFam, info_.targets, flags);
+
+	std::vector<CommandBuffer> readbackBuffers;
+	if(info_.readbackAttachment >= 0)
+		readbackBuffers = device().commandProvider().get(qFam, info_.targets, flags);
+
+	recycleTargets();
+	targets_.clear();
+	targets_.resize(info_.targets);
+	for(auto i = 0u; i < info_.targets; ++i)
+	{
+		auto& target = targets_[i];
+		target.framebuffer = Framebuffer(device(), info_.renderPass, info_.size, attachments,
+			info_.external);
+		target.commandBuffer = std::move(cmdBuffers[i]);
+		if(!readbackBuffers.empty()) target.readbackBuffer = std::move(readbackBuffers[i]);
+	}
+}
+
+void OffscreenRenderer::waitTargets()
+{
+	std::vector<vk::Fence> fences;
+	for(auto& target : targets_) if(target.fence) fences.push_back(target.fence);
+	if(!fences.empty()) vk::waitForFences(vkDevice(), fences, true, ~std::uint64_t(0));
+	for(auto& target : targets_) target.fence = {};
+}
+
+void OffscreenRenderer::recycleTargets()
+{
+	//called after waitTargets, none of the command buffers is pending anymore so they
+	//can be reused directly
+	for(auto& target : targets_)
+	{
+		for(auto* buffer : {&target.commandBuffer, &target.readbackBuffer})
+			if(buffer->vkHandle()) buffer->commandPool().recycle(std::move(*buffer), {});
+	}
+}
+
+void OffscreenRenderer::resize(const vk::Extent2D& size)
+{
+	waitTargets();
+	info_.size = size;
+	createTargets();
+	record();
+}
+
+void OffscreenRenderer::record(int id)
+{
+	if(id == -1) for(std::size_t i(0); i < targets_.size(); ++i) recordTarget(i);
+	else recordTarget(id);
+}
+
+void OffscreenRenderer::invalidate(int id)
+{
+	if(id == -1) for(auto& target : targets_) target.dirty = true;
+	else targets_[id].dirty = true;
+}
+
+void OffscreenRenderer::recordTarget(unsigned int id)
+{
+	auto clearValues = renderImpl_->clearValues(id);
+	auto width = info_.size.width;
+	auto height = info_.size.height;
+
+	auto& target = targets_[id];
+	auto vkbuf = target.commandBuffer.vkHandle();
+	target.dirty = false;
+
+	vk::RenderPassBeginInfo beginInfo;
+	beginInfo.renderPass = info_.renderPass;
+	beginInfo.renderArea = {{0, 0}, {width, height}};
+	beginInfo.clearValueCount = clearValues.size();
+	beginInfo.pClearValues = clearValues.data();
+	beginInfo.framebuffer = target.framebuffer;
+
+	vk::beginCommandBuffer(vkbuf, {});
+	if(timings_) timings_->writeBegin(vkbuf, id);
+
+	renderImpl_->beforeRender(vkbuf);
+	vk::cmdBeginRenderPass(vkbuf, beginInfo, vk::SubpassContents::eInline);
+
+	vk::Viewport viewport;
+	viewport.width = width;
+	viewport.height = height;
+	viewport.minDepth = 0.f;
+	viewport.maxDepth = 1.f;
+	vk::cmdSetViewport(vkbuf, 0, 1, viewport);
+
+	vk::Rect2D scissor;
+	scissor.extent = {width, height};
+	scissor.offset = {0, 0};
+	vk::cmdSetScissor(vkbuf, 0, 1, scissor);
+
+	RenderPassInstance ini(vkbuf, info_.renderPass, target.framebuffer);
+	renderImpl_->build(id, ini);
+
+	vk::cmdEndRenderPass(vkbuf);
+	renderImpl_->afterRender(vkbuf);
+
+	if(timings_) timings_->writeEnd(vkbuf, id);
+	vk::endCommandBuffer(vkbuf);
+}
+
+vk::Fence OffscreenRenderer::recordReadback(Target& target)
+{
+	auto vkbuf = target.readbackBuffer.vkHandle();
+	auto image = target.framebuffer.attachments()[info_.readbackAttachment].vkImage();
+
+	vk::beginCommandBuffer(vkbuf, {});
+
+	//the render pass leaves the image in the readback layout, only the attachment
+	//writes must be made visible to the copy
+	vk::ImageMemoryBarrier barrier;
+	barrier.image = image;
+	barrier.oldLayout = info_.readbackLayout;
+	barrier.newLayout = info_.readbackLayout;
+	barrier.srcAccessMask = vk::AccessBits::colorAttachmentWrite |
+		vk::AccessBits::depthStencilAttachmentWrite;
+	barrier.dstAccessMask = vk::AccessBits::transferRead;
+	barrier.srcQueueFamilyIndex = vk::queueFamilyIgnored;
+	barrier.dstQueueFamilyIndex = vk::queueFamilyIgnored;
+	barrier.subresourceRange = {readbackRegion_.imageSubresource.aspectMask, 0, 1, 0, 1};
+	vk::cmdPipelineBarrier(vkbuf, vk::PipelineStageBits::colorAttachmentOutput |
+		vk::PipelineStageBits::lateFragmentTests, vk::PipelineStageBits::transfer,
+		{}, {}, {}, {barrier});
+
+	//if all slots are pending the readback of this frame is skipped
+	auto fence = readback_.record(vkbuf, image, info_.readbackLayout, {readbackRegion_});
+	if(fence)
+	{
+		//the returned readback is always one of the last slotCount recorded ones
+		readbackFrames_.push_back({++readbackCount_, frameCount_});
+		if(readbackFrames_.size() > readback_.slotCount()) readbackFrames_.pop_front();
+	}
+
+	vk::endCommandBuffer(vkbuf);
+	return fence;
+}
+
+Range<std::uint8_t> OffscreenRenderer::readback(std::uint64_t* frame)
+{
+	if(frame) *frame = 0u;
+	if(info_.readbackAttachment < 0) return {};
+
+	std::uint64_t id;
+	auto data = readback_.latest(&id);
+	if(frame && id)
+	{
+		for(auto& entry : readbackFrames_)
+			if(entry.first == id) *frame = entry.second;
+	}
+
+	return data;
+}
+
+CommandExecutionState OffscreenRenderer::render(const Queue* queue)
+{
+	using Point = FrameTimings::Point;
+	if(timings_) timings_->begin();
+
+	if(!queue) queue = device().queue(info_.queueFamily);
+	if(!queue) throw std::logic_error("vpp::OffscreenRenderer::render: no render queue");
+
+	//only blocks if the gpu is still executing the frame rendered targets frames ago
+	current_ = (current_ + 1) % targets_.size();
+	auto& target = targets_[current_];
+	if(target.fence)
+	{
+		vk::waitForFences(vkDevice(), {target.fence.vkFence()}, true, ~std::uint64_t(0));
+		target.fence = {};
+	}
+
+	++frameCount_;
+	if(timings_)
+	{
+		timings_->query(current_);
+		timings_->mark(Point::acquireEnd);
+	}
+
+	renderImpl_->frame(current_);
+	if(timings_) timings_->mark(Point::frameEnd);
+
+	//the last frame of the target completed, so it can be re-recorded directly
+	if(target.dirty) recordTarget(current_);
+	if(timings_) timings_->mark(Point::recordEnd);
+
+	vk::Fence readbackFence {};
+	if(info_.readbackAttachment >= 0) readbackFence = recordReadback(target);
+
+	auto additionals = renderImpl_->submit(current_);
+	std::vector<vk::Semaphore> semaphores;
+	std::vector<vk::PipelineStageFlags> flags;
+	semaphores.reserve(additionals.size());
+	flags.reserve(additionals.size());
+
+	for(auto& sem : additionals)
+	{
+		semaphores.push_back(sem.first);
+		flags.push_back(sem.second);
+	}
+
+	vk::CommandBuffer cmdBuffers[] = {target.commandBuffer, target.readbackBuffer};
+
+	vk::SubmitInfo submitInfo;
+	submitInfo.waitSemaphoreCount = semaphores.size();
+	submitInfo.pWaitSemaphores = semaphores.data();
+	submitInfo.pWaitDstStageMask = flags.data();
+	submitInfo.commandBufferCount = (info_.readbackAttachment >= 0) ? 2 : 1;
+	submitInfo.pCommandBuffers = cmdBuffers;
+
+	CommandExecutionState execState;
+	auto& submitManager = device().submitManager();
+	submitManager.add(*queue, submitInfo, &execState);
+	submitManager.submit(*queue);
+
+	//the fence of the readback slot must be signaled by a submission after the copy.
+	//An empty submission signals it once all previously submitted commands completed.
+	if(readbackFence)
+	{
+		SubmitManager::Lock lock(device(), *queue);
+		vk::queueSubmit(*queue, {}, readbackFence);
+	}
+
+	target.fence = execState.fence();
+	if(timings_)
+	{
+		timings_->submitted(target.fence);
+		timings_->mark(Point::submitEnd);
+	}
+
+	return execState;
+}
+
+void OffscreenRenderer::renderBlock(const Queue* queue)
+{
+	render(queue).wait();
+}
+
+}
@@ -0,0 +1,163 @@
+#include <vpp/readback.hpp>
+#include <vpp/submit.hpp>
+#include <vpp/vk.hpp>
+#include <vpp/utility/debug.hpp>
+
+namespace vpp
+{
+
+ReadbackStream::ReadbackStream(const Device& dev, std::size_t size, unsigned int slots)
+	: Resource(dev), size_(size)
+{
+	VPP_DEBUG_CHECK(vpp::ReadbackStream,
+	{
+		if(slots < 2) VPP_DEBUG_OUTPUT("Less than 2 slots, every readback will stall");
+	})
+
+	vk::BufferCreateInfo info;
+	info.size = size;
+	info.usage = vk::BufferUsageBits::transferDst;
+
+	//host cached memory makes reading the data on the cpu a lot faster
+	auto bits = dev.memoryTypeBits(vk::MemoryPropertyBits::hostVisible |
+		vk::MemoryPropertyBits::hostCached);
+	if(!bits) bits = dev.memoryTypeBits(vk::MemoryPropertyBits::hostVisible);
+
+	//first request all buffers so they can be allocated together
+	slots_.resize(slots);
+	for(auto& slot : slots_) slot.buffer = Buffer(dev, info, bits);
+	for(auto& slot : slots_)
+	{
+		slot.map = slot.buffer.memoryMap();
+		slot.fence = Fence(dev);
+	}
+}
+
+ReadbackStream::~ReadbackStream()
+{
+	//the device must not write into any slot after its destruction.
+	//Slots that were recorded but never submitted would never be signaled, so instead
+	//of waiting for their fences wait until all submitted work has completed.
+	update();
+
+	auto pending = false;
+	for(auto& slot : slots_) pending |= slot.pending;
+	if(!pending) return;
+
+	device().submitManager().submit();
+	device().waitIdle();
+}
+
+void swap(ReadbackStream& a, ReadbackStream& b) noexcept
+{
+	using std::swap;
+
+	swap(a.resourceBase(), b.resourceBase());
+	swap(a.slots_, b.slots_);
+	swap(a.size_, b.size_);
+	swap(a.recorded_, b.recorded_);
+	swap(a.latest_, b.latest_);
+	swap(a.exposed_, b.exposed_);
+}
+
+vk::Fence ReadbackStream::record(vk::CommandBuffer cmdBuffer, vk::Buffer src,
+	std::size_t offset, std::size_t size)
+{
+	if(!size) size = size_;
+
+	VPP_DEBUG_CHECK(vpp::ReadbackStream::record,
+	{
+		if(size > size_) VPP_DEBUG_OUTPUT("Size ", size, " is larger than the slots");
+	})
+
+	auto slot = nextSlot();
+	if(!slot) return {};
+
+	vk::cmdCopyBuffer(cmdBuffer, src, slot->buffer, {{offset, 0, size}});
+
+	//make the transfer write visible to the host when the fence is signaled
+	vk::BufferMemoryBarrier barrier;
+	barrier.buffer = slot->buffer;
+	barrier.size = size;
+	barrier.srcAccessMask = vk::AccessBits::transferWrite;
+	barrier.dstAccessMask = vk::AccessBits::hostRead;
+	vk::cmdPipelineBarrier(cmdBuffer, vk::PipelineStageBits::transfer,
+		vk::PipelineStageBits::host, {}, {}, {barrier}, {});
+
+	return slot->fence;
+}
+
+vk::Fence ReadbackStream::record(vk::CommandBuffer cmdBuffer, vk::Image src,
+	vk::ImageLayout layout, const Range<vk::BufferImageCopy>& regions)
+{
+	auto slot = nextSlot();
+	if(!slot) return {};
+
+	vk::cmdCopyImageToBuffer(cmdBuffer, src, layout, slot->buffer, regions);
+
+	vk::BufferMemoryBarrier barrier;
+	barrier.buffer = slot->buffer;
+	barrier.size = size_;
+	barrier.srcAccessMask = vk::AccessBits::transferWrite;
+	barrier.dstAccessMask = vk::AccessBits::hostRead;
+	vk::cmdPipelineBarrier(cmdBuffer, vk::PipelineStageBits::transfer,
+		vk::PipelineStageBits::host, {}, {}, {barrier}, {});
+
+	return slot->fence;
+}
+
+Range<std::uint8_t> ReadbackStream::latest(std::uint64_t* id)
+{
+	update();
+
+	//only this function changes the exposed slot, update may make a newer slot the
+	//latest one at any time (e.g. in nextSlot)
+	exposed_ = latest_;
+
+	if(id) *id = exposed_ ? exposed_->id : 0u;
+	if(!exposed_) return {};
+	return Range<std::uint8_t>(*exposed_->map.ptr(), size_);
+}
+
+ReadbackStream::Slot* ReadbackStream::nextSlot()
+{
+	update();
+
+	//use the oldest slot that is neither pending nor the latest or exposed one
+	Slot* next = nullptr;
+	for(auto& slot : slots_)
+	{
+		if(slot.pending || &slot == latest_ || &slot == exposed_) continue;
+		if(!next || slot.id < next->id) next = &slot;
+	}
+
+	if(!next) return nullptr;
+
+	//only slots that were already used have a signaled fence
+	if(next->id)
+	{
+		vk::Fence fence = next->fence;
+		vk::resetFences(vkDevice(), 1, fence);
+	}
+
+	next->id = ++recorded_;
+	next->pending = true;
+	return next;
+}
+
+void ReadbackStream::update()
+{
+	for(auto& slot : slots_)
+	{
+		if(!slot.pending) continue;
+
+		//vkGetFenceStatus does never block
+		if(vk::getFenceStatus(vkDevice(), slot.fence) != vk::Result::success) continue;
+
+		slot.pending = false;
+		if(!slot.map.coherent()) slot.map.reload();
+		if(!latest_ || slot.id > latest_->id) latest_ = &slot;
+	}
+}
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vpp/fwd.hpp>
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+namespace vpp
+{
+
+//Used internally by the SwapChainRenderer and FrameGraph.
+
+///Worker threads for recording secondary command buffers.
+///Every secondary command buffer is allocated from the command pool of the worker thread
+///that records it and must therefore always be recorded by the same worker, so tasks
+///are added for a specific worker.
+struct RecordThreads
+{
+	struct Worker
+	{
+		std::thread thread;
+		std::vector<std::function<void()>> tasks;
+	};
+
+	std::vector<Worker> workers;
+	std::mutex mutex;
+	std::condition_variable taskCV;
+	std::condition_variable doneCV;
+	unsigned int pending {};
+	bool run {true};
+	std::exception_ptr error;
+
+	RecordThreads(unsigned int count) : workers(count)
+	{
+		for(auto i = 0u; i < count; ++i)
+			workers[i].thread = std::thread(&RecordThreads::main, this, i);
+	}
+
+	~RecordThreads()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			run = false;
+		}
+
+		taskCV.notify_all();
+		for(auto& worker : workers) worker.thread.join();
+	}
+
+	void add(unsigned int worker, std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			workers[worker % workers.size()].tasks.push_back(std::move(task));
+			++pending;
+		}
+
+		taskCV.notify_all();
+	}
+
+	//Waits until all tasks were executed and rethrows the first error of them.
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		doneCV.wait(lock, [&]{ return pending == 0; });
+
+		auto err = error;
+		error = {};
+		if(err) std::rethrow_exception(err);
+	}
+
+	void main(unsigned int id)
+	{
+		std::vector<std::function<void()>> tasks;
+		std::unique_lock<std::mutex> lock(mutex);
+		while(true)
+		{
+			taskCV.wait(lock, [&]{ return !run || !workers[id].tasks.empty(); });
+			if(!run) break;
+
+			tasks.swap(workers[id].tasks);
+			lock.unlock();
+
+			std::exception_ptr taskError;
+			for(auto& task : tasks)
+			{
+				try
+				{
+					task();
+				}
+				catch(...)
+				{
+					if(!taskError) taskError = std::current_exception();
+				}
+			}
+
+			lock.lock();
+			if(taskError && !error) error = taskError;
+			pending -= tasks.size();
+			tasks.clear();
+			if(pending == 0) doneCV.notify_all();
+		}
+	}
+};
+
+}
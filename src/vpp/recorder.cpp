@@ -0,0 +1,192 @@
+#include <vpp/recorder.hpp>
+#include <vpp/vk.hpp>
+
+#include <algorithm>
+#include <tuple>
+#include <cstring>
+
+namespace vpp
+{
+
+void CommandRecorder::bindPipeline(vk::PipelineBindPoint bindPoint, vk::Pipeline pipeline)
+{
+	++stats_.pipelines.requested;
+
+	auto& state = bindPoints_[static_cast<unsigned int>(bindPoint)];
+	if(state.pipeline == pipeline) return;
+
+	vk::cmdBindPipeline(commandBuffer_, bindPoint, pipeline);
+	state.pipeline = pipeline;
+	++stats_.pipelines.recorded;
+}
+
+void CommandRecorder::bindDescriptorSets(vk::PipelineBindPoint bindPoint,
+	vk::PipelineLayout layout, unsigned int firstSet, const Range<vk::DescriptorSet>& sets,
+	const Range<std::uint32_t>& dynamicOffsets)
+{
+	stats_.descriptorSets.requested += sets.size();
+
+	auto& state = bindPoints_[static_cast<unsigned int>(bindPoint)];
+	auto tracked = firstSet + sets.size() <= maxDescriptorSets;
+
+	//dynamic offsets are not tracked, sets using them are always bound
+	if(tracked && dynamicOffsets.empty() && state.layout == layout &&
+		std::equal(sets.begin(), sets.end(), state.sets.begin() + firstSet)) return;
+
+	vk::cmdBindDescriptorSets(commandBuffer_, bindPoint, layout, firstSet, sets, dynamicOffsets);
+	stats_.descriptorSets.recorded += sets.size();
+
+	//sets bound with another layout might be disturbed, so they are no longer known
+	if(state.layout != layout) state.sets = {};
+	state.layout = layout;
+
+	if(!tracked || !dynamicOffsets.empty()) state.sets = {};
+	else std::copy(sets.begin(), sets.end(), state.sets.begin() + firstSet);
+}
+
+void CommandRecorder::bindVertexBuffers(unsigned int firstBinding,
+	const Range<vk::Buffer>& buffers, const Range<vk::DeviceSize>& offsets)
+{
+	stats_.vertexBuffers.requested += buffers.size();
+
+	if(firstBinding + buffers.size() > maxVertexBindings)
+	{
+		vk::cmdBindVertexBuffers(commandBuffer_, firstBinding, buffers, offsets);
+		stats_.vertexBuffers.recorded += buffers.size();
+		return;
+	}
+
+	//only record the range of bindings that changed
+	auto begin = 0u;
+	auto end = static_cast<unsigned int>(buffers.size());
+	auto changed = [&](unsigned int i) {
+		return vertexBuffers_[firstBinding + i] != buffers[i] ||
+			vertexOffsets_[firstBinding + i] != offsets[i];
+	};
+
+	while(begin < end && !changed(begin)) ++begin;
+	while(end > begin && !changed(end - 1)) --end;
+	if(begin == end) return;
+
+	auto count = end - begin;
+	vk::cmdBindVertexBuffers(commandBuffer_, firstBinding + begin, count, buffers[begin],
+		offsets[begin]);
+	stats_.vertexBuffers.recorded += count;
+
+	std::copy(buffers.begin() + begin, buffers.begin() + end,
+		vertexBuffers_.begin() + firstBinding + begin);
+	std::copy(offsets.begin() + begin, offsets.begin() + end,
+		vertexOffsets_.begin() + firstBinding + begin);
+}
+
+void CommandRecorder::bindIndexBuffer(vk::Buffer buffer, vk::DeviceSize offset,
+	vk::IndexType type)
+{
+	++stats_.indexBuffers.requested;
+	if(indexBuffer_ == buffer && indexOffset_ == offset && indexType_ == type) return;
+
+	vk::cmdBindIndexBuffer(commandBuffer_, buffer, offset, type);
+	indexBuffer_ = buffer;
+	indexOffset_ = offset;
+	indexType_ = type;
+	++stats_.indexBuffers.recorded;
+}
+
+void CommandRecorder::setViewport(const vk::Viewport& viewport)
+{
+	++stats_.dynamicState.requested;
+	if(viewportValid_ && !std::memcmp(&viewport_, &viewport, sizeof(viewport))) return;
+
+	vk::cmdSetViewport(commandBuffer_, 0, 1, viewport);
+	viewport_ = viewport;
+	viewportValid_ = true;
+	++stats_.dynamicState.recorded;
+}
+
+void CommandRecorder::setScissor(const vk::Rect2D& scissor)
+{
+	++stats_.dynamicState.requested;
+	if(scissorValid_ && !std::memcmp(&scissor_, &scissor, sizeof(scissor))) return;
+
+	vk::cmdSetScissor(commandBuffer_, 0, 1, scissor);
+	scissor_ = scissor;
+	scissorValid_ = true;
+	++stats_.dynamicState.recorded;
+}
+
+void CommandRecorder::draw(std::uint32_t vertexCount, std::uint32_t instanceCount,
+	std::uint32_t firstVertex, std::uint32_t firstInstance)
+{
+	vk::cmdDraw(commandBuffer_, vertexCount, instanceCount, firstVertex, firstInstance);
+	++stats_.draws;
+}
+
+void CommandRecorder::drawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount,
+	std::uint32_t firstIndex, std::int32_t vertexOffset, std::uint32_t firstInstance)
+{
+	vk::cmdDrawIndexed(commandBuffer_, indexCount, instanceCount, firstIndex, vertexOffset,
+		firstInstance);
+	++stats_.draws;
+}
+
+void CommandRecorder::draw(const DrawPacket& packet)
+{
+	constexpr auto bindPoint = vk::PipelineBindPoint::graphics;
+
+	bindPipeline(bindPoint, packet.pipeline);
+	if(packet.descriptorSetCount)
+		bindDescriptorSets(bindPoint, packet.pipelineLayout, 0,
+			{packet.descriptorSets.data(), packet.descriptorSetCount});
+
+	if(packet.vertexBuffer)
+		bindVertexBuffers(0, {packet.vertexBuffer}, {packet.vertexBufferOffset});
+
+	if(packet.indexBuffer)
+	{
+		bindIndexBuffer(packet.indexBuffer, packet.indexBufferOffset, packet.indexType);
+		drawIndexed(packet.count, packet.instanceCount, packet.first, packet.vertexOffset,
+			packet.firstInstance);
+	}
+	else
+	{
+		draw(packet.count, packet.instanceCount, packet.first, packet.firstInstance);
+	}
+}
+
+void CommandRecorder::draw(const Range<DrawPacket>& packets, bool sort)
+{
+	if(!sort)
+	{
+		for(auto& packet : packets) draw(packet);
+		return;
+	}
+
+	sorted_.clear();
+	sorted_.reserve(packets.size());
+	for(auto& packet : packets) sorted_.push_back(&packet);
+
+	//the most expensive state changes come first in the sort key
+	auto key = [](const DrawPacket& p) {
+		return std::tie(p.pipeline, p.pipelineLayout, p.descriptorSets, p.descriptorSetCount,
+			p.vertexBuffer, p.vertexBufferOffset, p.indexBuffer, p.indexBufferOffset);
+	};
+
+	std::stable_sort(sorted_.begin(), sorted_.end(),
+		[&](const DrawPacket* a, const DrawPacket* b) { return key(*a) < key(*b); });
+
+	for(auto& packet : sorted_) draw(*packet);
+}
+
+void CommandRecorder::reset()
+{
+	bindPoints_ = {};
+	vertexBuffers_ = {};
+	vertexOffsets_ = {};
+	indexBuffer_ = {};
+	indexOffset_ = {};
+	indexType_ = {};
+	viewportValid_ = false;
+	scissorValid_ = false;
+}
+
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include <utility>
+
+namespace vpp
+{
+
+//Used internally by the CommandPool. Does not depend on vulkan, so it can be tested
+//without a device.
+
+///Threadsafe list of returned handles (e.g. command buffers) that are reused once they
+///are no longer in use. Every handle has a kind (e.g. the command buffer level) and
+///an optional fence (that has to be signaled before it can be reused).
+///Handles returned without knowing whether they are still in use are deferred and only
+///become reusable when it is known that nothing is in use anymore, i.e. after idle was
+///called or the given idle count (e.g. how often the device was waited idle) increased
+///since they were deferred.
+template<typename Handle, typename Fence>
+class Recycler
+{
+public:
+	struct Entry
+	{
+		Handle handle;
+		unsigned int kind;
+		Fence fence; //the handle may still be in use as long as it is not signaled
+		std::uint64_t idleCount; //for deferred handles, the idle count when deferred
+	};
+
+public:
+	///Returns a handle that can be reused once the given fence is signaled.
+	///If the fence is empty, it can be reused directly.
+	void release(Handle handle, unsigned int kind, Fence fence)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		entries_.push_back({handle, kind, std::move(fence), 0u});
+	}
+
+	///Returns a handle that might still be in use. It is deferred until idle is called
+	///or the idle count passed to take is larger than the given one.
+	void defer(Handle handle, unsigned int kind, std::uint64_t idleCount)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		deferred_.push_back({handle, kind, Fence {}, idleCount});
+	}
+
+	///Makes all deferred handles reusable.
+	void idle()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for(auto& entry : deferred_) entries_.push_back(std::move(entry));
+		deferred_.clear();
+	}
+
+	///Returns a reusable handle of the given kind or an empty handle if there is none.
+	///The signaled predicate is called with non-empty fences.
+	///If discard is true, all reusable handles of other kinds that are encountered are
+	///removed and passed to the given discard function.
+	///Deferred handles that were deferred with a lower idle count become reusable.
+	template<typename Signaled, typename Discard>
+	Handle take(unsigned int kind, std::uint64_t idleCount, Signaled&& signaled,
+		bool discard, Discard&& discarder)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for(auto i = 0u; i < deferred_.size();)
+		{
+			if(deferred_[i].idleCount >= idleCount)
+			{
+				++i;
+				continue;
+			}
+
+			entries_.push_back(std::move(deferred_[i]));
+			deferred_[i] = std::move(deferred_.back());
+			deferred_.pop_back();
+		}
+
+		for(auto i = 0u; i < entries_.size();)
+		{
+			auto& entry = entries_[i];
+			if((entry.fence && !signaled(entry.fence)) || (entry.kind != kind && !discard))
+			{
+				++i;
+				continue;
+			}
+
+			auto handle = entry.handle;
+			auto match = (entry.kind == kind);
+
+			//order does not matter
+			entry = std::move(entries_.back());
+			entries_.pop_back();
+
+			if(match) return handle;
+			discarder(handle);
+		}
+
+		return {};
+	}
+
+	///Removes all handles (also the pending and deferred ones) and passes them to the
+	///given function.
+	template<typename F>
+	void clear(F&& func)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for(auto& entry : entries_) func(entry.handle);
+		for(auto& entry : deferred_) func(entry.handle);
+		entries_.clear();
+		deferred_.clear();
+	}
+
+	///Returns the number of stored handles, including the ones whose fence is pending.
+	std::size_t size() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return entries_.size();
+	}
+
+	///Returns the number of deferred handles.
+	std::size_t deferred() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return deferred_.size();
+	}
+
+protected:
+	mutable std::mutex mutex_;
+	std::vector<Entry> entries_;
+	std::vector<Entry> deferred_;
+};
+
+}
@@ -4,6 +4,7 @@
 #include <vpp/queue.hpp>
 #include <vpp/provider.hpp>
 #include <vpp/submit.hpp>
+#include <vpp/recordThreads.hpp>
 #include <vpp/vk.hpp>
 
 #include <stdexcept>
@@ -11,8 +12,14 @@
 namespace vpp
 {
 
+//Worker threads recording the secondary command buffers.
+struct SwapChainRenderer::Recorder : public RecordThreads
+{
+	using RecordThreads::RecordThreads;
+};
+
 //SwapChainRenderer
-SwapChainRenderer::SwapChainRenderer(const SwapChain& sc, const CreateInfo& inf, RenderImpl bld)
+SwapChainRenderer::SwapChainRenderer(SwapChain& sc, const CreateInfo& inf, RenderImpl bld)
 {
 	create(sc, inf);
 	init(std::move(bld));
@@ -24,6 +31,13 @@ SwapChainRenderer::SwapChainRenderer(SwapChainRenderer&& other) noexcept
 	renderBuffers_ = std::move(other.renderBuffers_);
 	staticAttachments_ = std::move(other.staticAttachments_);
 	info_ = std::move(other.info_);
+	recorder_ = std::move(other.recorder_);
+	frames_ = std::move(other.frames_);
+	frameIndex_ = other.frameIndex_;
+	lastFence_ = std::move(other.lastFence_);
+	attachmentSize_ = other.attachmentSize_;
+	outdated_ = other.outdated_;
+	timings_ = std::move(other.timings_);
 
 	std::swap(swapChain_, other.swapChain_);
 }
@@ -36,21 +50,7 @@ SwapChainRenderer& SwapChainRenderer::operator=(SwapChainRenderer other) noexcep
 
 SwapChainRenderer::~SwapChainRenderer()
 {
-	///TODO: part of command buffer destruction rework
-	std::vector<vk::CommandBuffer> cmdBuffers;
-	cmdBuffers.reserve(renderBuffers_.size());
-
-	for(auto& renderer : renderBuffers_)
-	{
-		auto vkbuf = renderer.commandBuffer.vkHandle();
-		if(vkbuf) cmdBuffers.push_back(vkbuf);
-	}
-
-	if(!cmdBuffers.empty())
-	{
-		auto vkpool = renderBuffers_[0].commandBuffer.commandPool().vkHandle();
-		vk::freeCommandBuffers(vkDevice(), vkpool, cmdBuffers);
-	}
+	recycleBuffers();
 }
 
 void swap(SwapChainRenderer& a, SwapChainRenderer& b) noexcept
@@ -62,9 +62,16 @@ void swap(SwapChainRenderer& a, SwapChainRenderer& b) noexcept
 	swap(a.staticAttachments_, b.staticAttachments_);
 	swap(a.renderImpl_, b.renderImpl_);
 	swap(a.info_, b.info_);
+	swap(a.recorder_, b.recorder_);
+	swap(a.frames_, b.frames_);
+	swap(a.frameIndex_, b.frameIndex_);
+	swap(a.lastFence_, b.lastFence_);
+	swap(a.attachmentSize_, b.attachmentSize_);
+	swap(a.outdated_, b.outdated_);
+	swap(a.timings_, b.timings_);
 }
 
-void SwapChainRenderer::create(const SwapChain& swapChain, const CreateInfo& info)
+void SwapChainRenderer::create(SwapChain& swapChain, const CreateInfo& info)
 {
 	if(!info.renderPass)
 	{
@@ -73,48 +80,54 @@ void SwapChainRenderer::create(const SwapChain& swapChain, const CreateInfo& inf
 
 	swapChain_ = &swapChain;
 	info_ = info;
+	createAttachments();
+
+	//the first rendered frame uses the first frame in flight
+	frames_.resize(info.framesInFlight);
+	frameIndex_ = info.framesInFlight ? info.framesInFlight - 1 : 0;
+}
 
-	//attachments
-	//TODO: more efficient: reserve/resize prediction?
+void SwapChainRenderer::init(RenderImpl builder)
+{
+	renderImpl_ = std::move(builder);
+	initFramebuffers();
+	renderImpl_->init(*this);
+}
+
+void SwapChainRenderer::createAttachments()
+{
+	//attachments are created with the maximum size, so they must only be recreated if
+	//the swap chain gets larger than that
 	std::vector<ViewableImage::CreateInfo> dynamic;
-	Framebuffer::ExtAttachments ext;
-	auto size = swapChain.size();
-	auto i = 0u;
+	auto size = swapChain().size();
+	attachmentSize_.width = std::max(size.width, info_.maxWidth);
+	attachmentSize_.height = std::max(size.height, info_.maxHeight);
 
 	for(auto& attachInfo : info_.attachments)
 	{
-		if(i == info.swapChainAttachment) ++i;
-		if(attachInfo.external)
-		{
-			ext[i] = attachInfo.external;
-		}
-		else if(attachInfo.dynamic)
+		if(attachInfo.external) continue;
+
+		auto& imgInfo = attachInfo.createInfo.imgInfo;
+		imgInfo.extent = {attachmentSize_.width, attachmentSize_.height, 1};
+
+		if(attachInfo.dynamic)
 		{
-			auto& imgInfo = attachInfo.createInfo.imgInfo;
-			imgInfo.extent.width = std::max(size.width, info.maxWidth);
-			imgInfo.extent.height = std::max(size.height, info.maxHeight);
-			imgInfo.extent.depth = 1;
 			dynamic.push_back(attachInfo.createInfo);
 		}
 		else
 		{
-			auto& imgInfo = attachInfo.createInfo.imgInfo;
-			imgInfo.extent.width = std::max(size.width, info.maxWidth);
-			imgInfo.extent.height = std::max(size.height, info.maxHeight);
-			imgInfo.extent.depth = 1;
 			staticAttachments_.emplace_back();
 			staticAttachments_.back().create(device(), imgInfo, attachInfo.createInfo.memoryFlags);
 		}
-
-		++i;
 	}
 
 	//RenderBuffers
 	//CommandBuffers
-	renderBuffers_.reserve(swapChain.renderBuffers().size());
+	auto count = swapChain().renderBuffers().size();
+	renderBuffers_.reserve(count);
 
-	auto qFam = info.queueFamily;
-	auto cmdBuffers = device().commandProvider().get(qFam, swapChain.renderBuffers().size(),
+	auto qFam = info_.queueFamily;
+	auto cmdBuffers = device().commandProvider().get(qFam, count,
 		vk::CommandPoolCreateBits::resetCommandBuffer);
 
 	//frame buffers
@@ -122,67 +135,195 @@ void SwapChainRenderer::create(const SwapChain& swapChain, const CreateInfo& inf
 	{
 		renderBuffers_.emplace_back();
 		renderBuffers_.back().commandBuffer = std::move(cmdBuffer);
-		renderBuffers_.back().framebuffer.create(device(), swapChain.size(), dynamic);
+		renderBuffers_.back().framebuffer.create(device(), size, dynamic);
 	}
+
+	//the timestamp queries are used per render buffer, the recorded timings are kept
+	//as long as their number does not change
+	if(info_.timingFrames && (!timings_ || timings_->queries() != count))
+		timings_ = std::make_unique<FrameTimings>(device(), info_.timingFrames, count, qFam);
 }
 
-void SwapChainRenderer::init(RenderImpl builder)
+void SwapChainRenderer::initFramebuffers()
 {
-	Framebuffer::ExtAttachments attachmentMap;
 	std::vector<vk::ImageViewCreateInfo> viewInfos;
+	auto staticID = 0u;
 
-	renderImpl_ = std::move(builder);
+	for(auto& ainfo : info_.attachments)
+	{
+		if(ainfo.external) continue;
+		if(ainfo.dynamic) viewInfos.push_back(ainfo.createInfo.viewInfo);
+		else staticAttachments_[staticID++].init(ainfo.createInfo.viewInfo);
+	}
+
+	auto attachmentMap = sharedAttachments();
+	for(std::size_t i(0); i < renderBuffers_.size(); i++)
+	{
+		attachmentMap[info_.swapChainAttachment] = swapChain().renderBuffers()[i].imageView;
+		renderBuffers_[i].framebuffer.init(info_.renderPass, viewInfos, attachmentMap);
+	}
+}
 
-	//attachments
-	auto staticAttachmentID = 0u; //staticAttachments_ id
-	auto attachmentMapID = 0u; //attachmentMap[] id
-	auto attachInfoID = 0u; //info_.attachments id
+Framebuffer::ExtAttachments SwapChainRenderer::sharedAttachments() const
+{
+	//dynamic attachments are skipped, the framebuffers fill the gaps with them
+	Framebuffer::ExtAttachments ret;
+	auto id = 0u;
+	auto staticID = 0u;
 
-	for(auto i = 0u; i < info_.attachments.size(); ++i)
+	for(auto& ainfo : info_.attachments)
 	{
-		if(attachmentMapID == info_.swapChainAttachment) attachmentMapID++;
+		if(id == info_.swapChainAttachment) ++id;
+		if(ainfo.external) ret[id] = ainfo.external;
+		else if(!ainfo.dynamic) ret[id] = staticAttachments_[staticID++].vkImageView();
+		++id;
+	}
 
-		auto& ainfo = info_.attachments[attachInfoID];
-		if(!ainfo.external && !ainfo.dynamic)
-		{
-			auto& statAttach = staticAttachments_[staticAttachmentID];
-			statAttach.init(ainfo.createInfo.viewInfo);
-			attachmentMap[attachmentMapID] = statAttach.vkImageView();
+	return ret;
+}
 
-			attachmentMapID++;
-			staticAttachmentID++;
-		}
-		else if(!ainfo.external && ainfo.dynamic)
-		{
-			viewInfos.push_back(ainfo.createInfo.viewInfo);
-		}
-		else if(ainfo.external)
+void SwapChainRenderer::resize(const vk::Extent2D& size, const SwapChainSettings& settings)
+{
+	//the framebuffers and the old swap chain may still be used by submitted frames
+	waitFrames();
+
+	auto count = swapChain().renderBuffers().size();
+	swapChain_->resize(size, settings);
+	outdated_ = false;
+
+	auto newSize = swapChain().size();
+	if(newSize.width > attachmentSize_.width || newSize.height > attachmentSize_.height ||
+		count != swapChain().renderBuffers().size())
+	{
+		recycleBuffers();
+		renderBuffers_.clear();
+		staticAttachments_.clear();
+		createAttachments();
+		initFramebuffers();
+	}
+	else
+	{
+		//the attachment images are still large enough, only the framebuffers using the
+		//new swap chain images have to be recreated
+		auto attachmentMap = sharedAttachments();
+		for(std::size_t i(0); i < renderBuffers_.size(); i++)
 		{
-			attachmentMap[attachmentMapID] = ainfo.external;
-			attachmentMapID++;
+			attachmentMap[info_.swapChainAttachment] = swapChain().renderBuffers()[i].imageView;
+			renderBuffers_[i].framebuffer.resize(info_.renderPass, newSize, attachmentMap);
 		}
+	}
+
+	//all command buffers reference the framebuffers
+	record();
+}
+
+void SwapChainRenderer::waitFrames()
+{
+	std::vector<vk::Fence> fences;
+	for(auto& frame : frames_) if(frame.fence) fences.push_back(frame.fence);
+	if(lastFence_) fences.push_back(lastFence_);
 
-		++attachInfoID;
+	if(!fences.empty()) vk::waitForFences(vkDevice(), fences, true, ~std::uint64_t(0));
+}
+
+void SwapChainRenderer::recycleBuffers()
+{
+	//the command buffers may still be pending, they can be reused by their pools
+	//(which might belong to other threads for the secondary buffers) once the fence
+	//of their last submission is signaled
+	for(auto& renderBuffer : renderBuffers_)
+	{
+		auto recycle = [&](CommandBuffer& buffer) {
+			if(buffer.vkHandle())
+				buffer.commandPool().recycle(std::move(buffer), renderBuffer.fence);
+		};
+
+		recycle(renderBuffer.commandBuffer);
+		for(auto& buffer : renderBuffer.secondaryBuffers) recycle(buffer);
 	}
+}
 
-	//frameBufferAttachment resources
-	for(std::size_t i(0); i < renderBuffers_.size(); i++)
+void SwapChainRenderer::record(int id)
+{
+	if(info_.secondaryBuffers)
 	{
-		attachmentMap[info_.swapChainAttachment] = swapChain().renderBuffers()[i].imageView;
-		renderBuffers_[i].framebuffer.init(info_.renderPass, viewInfos, attachmentMap);
+		//record the secondary command buffers of all given render buffers concurrently
+		if(id == -1) for(std::size_t i(0); i < renderBuffers_.size(); ++i) queueSecondary(i);
+		else queueSecondary(id);
+
+		recorder_->wait();
 	}
 
-	renderImpl_->init(*this);
+	if(id == -1) for(std::size_t i(0); i < renderBuffers_.size(); ++i) recordPrimary(i);
+	else recordPrimary(id);
 }
 
-void SwapChainRenderer::record(int id)
+void SwapChainRenderer::invalidate(int id)
+{
+	if(id == -1) for(auto& buffer : renderBuffers_) buffer.dirty = true;
+	else renderBuffers_[id].dirty = true;
+}
+
+void SwapChainRenderer::queueSecondary(unsigned int id)
 {
-	if(id == -1)
+	if(!recorder_)
 	{
-		for(std::size_t i(0); i < renderBuffers_.size(); ++i) record(i);
-		return;
+		auto count = info_.recordThreads;
+		if(!count) count = std::max(std::thread::hardware_concurrency(), 1u);
+		recorder_ = std::make_unique<Recorder>(count);
 	}
 
+	renderBuffers_[id].secondaryBuffers.resize(info_.secondaryBuffers);
+	for(auto i = 0u; i < info_.secondaryBuffers; ++i)
+		recorder_->add(i, [=]{ recordSecondary(id, i); });
+}
+
+void SwapChainRenderer::recordSecondary(unsigned int id, unsigned int index)
+{
+	auto& renderer = renderBuffers_[id];
+	auto& buffer = renderer.secondaryBuffers[index];
+
+	//allocated from the command pool of the calling worker thread
+	if(!buffer.vkHandle())
+		buffer = device().commandProvider().get(info_.queueFamily, {},
+			vk::CommandBufferLevel::secondary);
+
+	auto width = swapChain().size().width;
+	auto height = swapChain().size().height;
+
+	vk::CommandBufferInheritanceInfo inheritance;
+	inheritance.renderPass = info_.renderPass;
+	inheritance.subpass = 0;
+	inheritance.framebuffer = renderer.framebuffer;
+
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = vk::CommandBufferUsageBits::renderPassContinue;
+	beginInfo.pInheritanceInfo = &inheritance;
+
+	auto vkbuf = buffer.vkHandle();
+	vk::beginCommandBuffer(vkbuf, beginInfo);
+
+	//dynamic state is not inherited from the primary command buffer
+	vk::Viewport viewport;
+	viewport.width = width;
+	viewport.height = height;
+	viewport.minDepth = 0.f;
+	viewport.maxDepth = 1.f;
+	vk::cmdSetViewport(vkbuf, 0, 1, viewport);
+
+	vk::Rect2D scissor;
+	scissor.extent = {width, height};
+	scissor.offset = {0, 0};
+	vk::cmdSetScissor(vkbuf, 0, 1, scissor);
+
+	RenderPassInstance ini(vkbuf, info_.renderPass, renderer.framebuffer);
+	renderImpl_->buildSecondary(id, index, ini);
+
+	vk::endCommandBuffer(vkbuf);
+}
+
+void SwapChainRenderer::recordPrimary(unsigned int id)
+{
 	auto clearValues = renderImpl_->clearValues(id);
 	auto width = swapChain().size().width;
 	auto height = swapChain().size().height;
@@ -200,6 +341,7 @@ void SwapChainRenderer::record(int id)
 	auto& renderer = renderBuffers_[id];
 	auto vkbuf = renderer.commandBuffer.vkHandle();
 	vk::CommandBufferBeginInfo cmdBufInfo;
+	renderer.dirty = false;
 
 	vk::RenderPassBeginInfo beginInfo;
 	beginInfo.renderPass = info_.renderPass;
@@ -209,6 +351,7 @@ void SwapChainRenderer::record(int id)
 	beginInfo.framebuffer = renderer.framebuffer;
 
 	vk::beginCommandBuffer(vkbuf, cmdBufInfo);
+	if(timings_) timings_->writeBegin(vkbuf, id);
 
 	// //present to attachment layout
 	// vk::cmdPipelineBarrier(vkbuf, vk::PipelineStageBits::allCommands,
@@ -216,26 +359,39 @@ void SwapChainRenderer::record(int id)
 
 	renderImpl_->beforeRender(vkbuf);
 
-	vk::cmdBeginRenderPass(vkbuf, beginInfo, vk::SubpassContents::eInline);
-
-	//Update dynamic viewport state
-	vk::Viewport viewport;
-	viewport.width = width;
-	viewport.height = height;
-	viewport.minDepth = 0.f;
-	viewport.maxDepth = 1.f;
-	vk::cmdSetViewport(vkbuf, 0, 1, viewport);
-
-	//Update dynamic scissor state
-	vk::Rect2D scissor;
-	scissor.extent = {width, height};
-	scissor.offset = {0, 0};
-	vk::cmdSetScissor(vkbuf, 0, 1, scissor);
-
-	RenderPassInstance ini(vkbuf, info_.renderPass, renderer.framebuffer);
-	renderImpl_->build(id, ini);
+	if(info_.secondaryBuffers)
+	{
+		std::vector<vk::CommandBuffer> secondary;
+		secondary.reserve(renderer.secondaryBuffers.size());
+		for(auto& buffer : renderer.secondaryBuffers) secondary.push_back(buffer);
 
-	vk::cmdEndRenderPass(vkbuf);
+		vk::cmdBeginRenderPass(vkbuf, beginInfo, vk::SubpassContents::secondaryCommandBuffers);
+		vk::cmdExecuteCommands(vkbuf, secondary);
+		vk::cmdEndRenderPass(vkbuf);
+	}
+	else
+	{
+		vk::cmdBeginRenderPass(vkbuf, beginInfo, vk::SubpassContents::eInline);
+
+		//Update dynamic viewport state
+		vk::Viewport viewport;
+		viewport.width = width;
+		viewport.height = height;
+		viewport.minDepth = 0.f;
+		viewport.maxDepth = 1.f;
+		vk::cmdSetViewport(vkbuf, 0, 1, viewport);
+
+		//Update dynamic scissor state
+		vk::Rect2D scissor;
+		scissor.extent = {width, height};
+		scissor.offset = {0, 0};
+		vk::cmdSetScissor(vkbuf, 0, 1, scissor);
+
+		RenderPassInstance ini(vkbuf, info_.renderPass, renderer.framebuffer);
+		renderImpl_->build(id, ini);
+
+		vk::cmdEndRenderPass(vkbuf);
+	}
 
 	renderImpl_->afterRender(vkbuf);
 
@@ -249,6 +405,7 @@ void SwapChainRenderer::record(int id)
 	// vk::cmdPipelineBarrier(vkbuf, vk::PipelineStageBits::allCommands,
 	// 	vk::PipelineStageBits::topOfPipe, vk::DependencyFlags(), {}, {}, {barrier});
 
+	if(timings_) timings_->writeEnd(vkbuf, id);
 	vk::endCommandBuffer(vkbuf);
 }
 
@@ -257,77 +414,27 @@ std::unique_ptr<Work<void>> SwapChainRenderer::render(const Queue* present, cons
 	if(present == nullptr) present = device().queues()[0].get();
 	if(gfx == nullptr) gfx = device().queues()[0].get();
 
-    vk::SemaphoreCreateInfo semaphoreCI;
-	auto acquireComplete = vk::createSemaphore(vkDevice(), semaphoreCI);
-	auto renderComplete = vk::createSemaphore(vkDevice(), semaphoreCI);
-
-	unsigned int currentBuffer;
-    swapChain().acquire(currentBuffer, acquireComplete);
-	//TODO: result error handling, out_of_date or suboptimal/invalid
-    // auto result = swapChain().acquire(currentBuffer, acquireComplete);
-
-	renderImpl_->frame(currentBuffer);
-
-	auto& cmdBuf = renderBuffers_[currentBuffer].commandBuffer;
-	auto additionals = renderImpl_->submit(currentBuffer);
-
-	std::vector<vk::Semaphore> semaphores {acquireComplete};
-	std::vector<vk::PipelineStageFlags> flags {vk::PipelineStageBits::colorAttachmentOutput};
-	semaphores.reserve(additionals.size() + 1);
-	flags.reserve(additionals.size() + 1);
-
-	for(auto& sem : additionals)
-	{
-		semaphores.push_back(sem.first);
-		flags.push_back(sem.second);
-	}
-
-	vk::SubmitInfo submitInfo;
-	submitInfo.waitSemaphoreCount = semaphores.size();
-	submitInfo.pWaitSemaphores = semaphores.data();
-	submitInfo.pWaitDstStageMask = flags.data();
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &cmdBuf.vkHandle();
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = &renderComplete;
-
 	CommandExecutionState execState;
-	device().submitManager().add(*gfx, submitInfo, &execState);
-
-	//TODO: which kind of submit makes sence here? submit ALL queued commands?
-	//execState.submit();
-	device().submitManager().submit();
-
-	//TODO: some kind of queue lock? must be synchronized.
-	//need some submitmanager improvements as general queue sync manager.
-    swapChain().present(*present, currentBuffer, renderComplete);
+	if(!renderFrame(*present, *gfx, execState)) return std::make_unique<FinishedWork<void>>();
 
 	class WorkImpl : public Work<void>
 	{
 	public:
-		vk::Semaphore acquire_;
-		vk::Semaphore render_;
 		CommandExecutionState executionState_;
 		WorkBase::State state_ = WorkBase::State::submitted;
 
-		WorkImpl(vk::Semaphore acquire, vk::Semaphore render, CommandExecutionState state)
-			: acquire_(acquire), render_(render), executionState_(std::move(state)) {}
+		WorkImpl(CommandExecutionState state) : executionState_(std::move(state)) {}
 
 		virtual void finish() override
 		{
 			wait();
-			auto& dev = executionState_.device();
-
-    		if(acquire_) vk::destroySemaphore(dev, acquire_, nullptr);
-    		if(render_) vk::destroySemaphore(dev, render_, nullptr);
-
-			acquire_ = {};
-			render_ = {};
-
 			state_ = WorkBase::State::finished;
 		}
 		virtual WorkBase::State state() override
 		{
+			if(state_ == WorkBase::State::submitted && executionState_.completed())
+				state_ = WorkBase::State::executed;
+
 			return state_;
 		}
 		virtual void submit() override
@@ -341,9 +448,13 @@ std::unique_ptr<Work<void>> SwapChainRenderer::render(const Queue* present, cons
 			executionState_.wait();
 			state_ = WorkBase::State::executed;
 		}
+		virtual const CommandExecutionState* executionState() override
+		{
+			return &executionState_;
+		}
 	};
 
-	return std::make_unique<WorkImpl>(acquireComplete, renderComplete, std::move(execState));
+	return std::make_unique<WorkImpl>(std::move(execState));
 }
 
 void SwapChainRenderer::renderBlock(const Queue* gfx, const Queue* present)
@@ -351,21 +462,98 @@ void SwapChainRenderer::renderBlock(const Queue* gfx, const Queue* present)
 	if(present == nullptr) present = device().queues()[0].get();
 	if(gfx == nullptr) gfx = device().queues()[0].get();
 
-    vk::SemaphoreCreateInfo semaphoreCI;
-	auto acquireComplete = vk::createSemaphore(vkDevice(), semaphoreCI);
-	auto renderComplete = vk::createSemaphore(vkDevice(), semaphoreCI);
+	CommandExecutionState execState;
+	if(renderFrame(*present, *gfx, execState)) execState.wait();
+}
 
+bool SwapChainRenderer::renderFrame(const Queue& present, const Queue& gfx,
+	CommandExecutionState& execState)
+{
+	using Point = FrameTimings::Point;
+	if(timings_) timings_->begin();
+	if(outdated_) resize();
+
+	auto& semaphorePool = device().semaphorePool();
+	Frame* frame = nullptr;
+	PooledSemaphore acquireComplete;
+
+	if(!frames_.empty())
+	{
+		frameIndex_ = (frameIndex_ + 1) % frames_.size();
+		frame = &frames_[frameIndex_];
+
+		//only blocks if the gpu is still executing the frame rendered framesInFlight
+		//frames ago. Afterwards its acquire semaphore is no longer waited on.
+		if(frame->fence)
+		{
+			vk::waitForFences(vkDevice(), {frame->fence.vkFence()}, true,
+				~std::uint64_t(0));
+			frame->fence = {};
+		}
+
+		if(!frame->acquireComplete) frame->acquireComplete = semaphorePool.get();
+	}
+	else
+	{
+		acquireComplete = semaphorePool.get();
+	}
+
+	vk::Semaphore acquireSemaphore = frame ? frame->acquireComplete : acquireComplete;
+
+	//if the swap chain is out of date, it is recreated and acquiring retried once.
+	//If it is still out of date (e.g. for a minimized window), no frame is rendered.
+	//A semaphore passed to a failed acquire is not signaled and can be reused.
 	unsigned int currentBuffer;
-    swapChain().acquire(currentBuffer, acquireComplete);
-	//TODO: result error handling, out_of_date or suboptimal/invalid
-    // auto result = swapChain().acquire(currentBuffer, acquireComplete);
-	
+	auto result = swapChain().acquire(currentBuffer, acquireSemaphore);
+	if(result == vk::Result::errorOutOfDateKHR)
+	{
+		resize();
+		result = swapChain().acquire(currentBuffer, acquireSemaphore);
+		if(result == vk::Result::errorOutOfDateKHR)
+		{
+			outdated_ = true;
+			return false;
+		}
+	}
+
+	//a suboptimal swap chain can still be used, it is recreated before the next frame
+	if(result == vk::Result::suboptimalKHR) outdated_ = true;
+	else if(result != vk::Result::success)
+		throw std::runtime_error("vpp::SwapChainRenderer::render: acquiring failed");
+
+	//the image was acquired again, therefore its last present finished waiting on the
+	//render semaphore and it can be reused
+	auto& renderBuffer = renderBuffers_[currentBuffer];
+	auto& renderComplete = renderBuffer.renderComplete;
+	if(!renderComplete) renderComplete = semaphorePool.get();
+
+	//acquiring the image does not guarantee that the last submission of its command
+	//buffer completed (e.g. with mailbox present or without frames in flight) and it
+	//must not be resubmitted or re-recorded (also by the builder in frame) while pending
+	if(renderBuffer.fence)
+	{
+		vk::waitForFences(vkDevice(), {renderBuffer.fence.vkFence()}, true,
+			~std::uint64_t(0));
+		renderBuffer.fence = {};
+	}
+
+	if(timings_)
+	{
+		timings_->query(currentBuffer);
+		timings_->mark(Point::acquireEnd);
+	}
+
 	renderImpl_->frame(currentBuffer);
+	if(timings_) timings_->mark(Point::frameEnd);
+
+	//invalidated buffers are only re-recorded when they are used
+	if(renderBuffer.dirty) record(currentBuffer);
 
-	auto& cmdBuf = renderBuffers_[currentBuffer].commandBuffer;
+	auto& cmdBuf = renderBuffer.commandBuffer;
+	if(timings_) timings_->mark(Point::recordEnd);
 	auto additionals = renderImpl_->submit(currentBuffer);
 
-	std::vector<vk::Semaphore> semaphores {acquireComplete};
+	std::vector<vk::Semaphore> semaphores {acquireSemaphore};
 	std::vector<vk::PipelineStageFlags> flags {vk::PipelineStageBits::colorAttachmentOutput};
 	semaphores.reserve(additionals.size() + 1);
 	flags.reserve(additionals.size() + 1);
@@ -383,23 +571,32 @@ void SwapChainRenderer::renderBlock(const Queue* gfx, const Queue* present)
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &cmdBuf.vkHandle();
 	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = &renderComplete;
+	submitInfo.pSignalSemaphores = &renderComplete.vkHandle();
 
-	CommandExecutionState execState;
-	device().submitManager().add(*gfx, submitInfo, &execState);
+	device().submitManager().add(gfx, submitInfo, &execState);
 
 	//TODO: which kind of submit makes sense here? submit ALL queued commands?
 	//execState.submit();
 	device().submitManager().submit();
+	lastFence_ = execState.fence();
+	renderBuffer.fence = lastFence_;
+	if(frame) frame->fence = lastFence_;
+	else semaphorePool.recycle(std::move(acquireComplete), execState);
 
-	//TODO: some kind of queue lock? must be synchronized.
-	//need some submitmanager improvements as general queue sync manager.
-    swapChain().present(*present, currentBuffer, renderComplete);
+	if(timings_)
+	{
+		timings_->submitted(lastFence_);
+		timings_->mark(Point::submitEnd);
+	}
 
-	execState.wait();
+	result = swapChain().present(present, currentBuffer, renderComplete);
+	if(timings_) timings_->mark(Point::presentEnd);
+	if(result == vk::Result::suboptimalKHR || result == vk::Result::errorOutOfDateKHR)
+		outdated_ = true;
+	else if(result != vk::Result::success)
+		throw std::runtime_error("vpp::SwapChainRenderer::render: presenting failed");
 
-    vk::destroySemaphore(device(), acquireComplete, nullptr);
-	vk::destroySemaphore(device(), renderComplete, nullptr);
+	return true;
 }
 
 }
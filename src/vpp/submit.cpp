@@ -1,20 +1,51 @@
 #include <vpp/submit.hpp>
 #include <vpp/queue.hpp>
 #include <vpp/vk.hpp>
+#include <vpp/utility/debug.hpp>
 #include <algorithm>
+#include <stdexcept>
+#include <exception>
+#include <iostream>
 
 namespace vpp
 {
 
+//lock typedef for easier lock_guard using
+using LockGuard = std::lock_guard<std::mutex>;
+using Clock = std::chrono::steady_clock;
+
 struct SubmitManager::Submission
 {
 	vk::SubmitInfo info;
 	std::vector<vk::CommandBuffer> buffers;
-	std::unique_ptr<CommandExecutionState*> state;
+	CommandExecutionState* state {}; //guarded by the mutex of the queue
+	Submission* next {};
+	std::uint64_t order {}; //position in the submission order of the queue
+
+	//semaphores added by dependencies, guarded by the mutex of the queue
+	std::vector<vk::Semaphore> waitSemaphores;
+	std::vector<vk::PipelineStageFlags> waitStages;
+	std::vector<vk::Semaphore> signalSemaphores;
+	std::vector<PooledSemaphore> semaphores; //the wait semaphores, recycled after completion
+	std::vector<CompletionMonitor::Callback> callbacks; //passed to the monitor on submission
 };
 
-//lock typedef for easier lock_guard using
-using LockGuard = std::lock_guard<std::mutex>;
+struct SubmitManager::QueueSubmissions
+{
+	const Queue* queue {};
+	unsigned int index {}; //index in SubmitManager::queues_
+	std::atomic<std::uint64_t> order {}; //counter for Submission::order
+	std::atomic<std::uint64_t> dependencies {}; //bitmask of queues pending submissions wait on
+	std::atomic<Submission*> pending {}; //lock-free stack, newest submission first
+	std::atomic<int> bufferCount {}; //number of pending command buffers
+	std::atomic<Clock::rep> since {}; //time the first of the pending submissions was added
+
+	std::mutex mutex; //serializes flushing and the access of states to their submission
+	std::uint64_t submitted {}; //id of the last submission, guarded by mutex
+	std::atomic<std::uint64_t> completed {}; //id of the last submission known to be completed
+	std::vector<Submission*> submissions; //only used while flushing
+	std::vector<vk::SubmitInfo> infos; //only used while flushing
+};
 
 //Fence
 Fence::Fence(const Device& dev) : Fence(dev, {})
@@ -37,38 +68,381 @@ void swap(Fence& a, Fence& b) noexcept
 	std::swap(a.resourceBase(), b.resourceBase());
 }
 
-//ExecutionState
-CommandExecutionState::CommandExecutionState(const Device& dev, CommandExecutionState** ptr)
-	: Resource(dev), self_(ptr)
+//FenceRef
+FenceRef::FenceRef(const FenceRef& other) noexcept : entry_(other.entry_)
+{
+	if(entry_) ++entry_->references;
+}
+
+FenceRef::~FenceRef()
+{
+	if(entry_ && --entry_->references == 0) entry_->pool.release(*entry_);
+}
+
+vk::Fence FenceRef::vkFence() const
+{
+	return entry_ ? entry_->fence : vk::Fence {};
+}
+
+//FencePool
+FencePool::FencePool(const Device& dev) : Resource(dev)
+{
+}
+
+FencePool::~FencePool()
+{
+	VPP_DEBUG_CHECK(vpp::~FencePool,
+	{
+		if(unused_.size() != entries_.size())
+			VPP_DEBUG_OUTPUT(entries_.size() - unused_.size(), " fences are still referenced");
+	})
+
+	for(auto& entry : entries_) vk::destroyFence(vkDevice(), entry.fence);
+}
+
+FenceRef FencePool::get()
+{
+	LockGuard lock(mutex_);
+
+	//fences are usually signaled in the order they were returned
+	for(auto it = unused_.begin(); it != unused_.end(); ++it)
+	{
+		auto& entry = **it;
+		if(vk::getFenceStatus(vkDevice(), entry.fence) != vk::Result::success) continue;
+
+		vk::resetFences(vkDevice(), 1, entry.fence);
+		unused_.erase(it);
+		entry.references = 1;
+		++reused_;
+		return {entry};
+	}
+
+	entries_.emplace_back(*this, vk::createFence(vkDevice(), {}));
+	entries_.back().references = 1;
+	++created_;
+	return {entries_.back()};
+}
+
+void FencePool::release(FenceRef::Entry& entry)
+{
+	LockGuard lock(mutex_);
+	unused_.push_back(&entry);
+}
+
+//PooledSemaphore
+PooledSemaphore::~PooledSemaphore()
+{
+	if(semaphore_) pool_->release(semaphore_);
+}
+
+void swap(PooledSemaphore& a, PooledSemaphore& b) noexcept
+{
+	std::swap(a.pool_, b.pool_);
+	std::swap(a.semaphore_, b.semaphore_);
+}
+
+//SemaphorePool
+SemaphorePool::SemaphorePool(const Device& dev) : Resource(dev)
+{
+}
+
+SemaphorePool::~SemaphorePool()
+{
+	VPP_DEBUG_CHECK(vpp::~SemaphorePool,
+	{
+		auto free = unused_.size() + recycled_.size();
+		if(free != semaphores_.size())
+			VPP_DEBUG_OUTPUT(semaphores_.size() - free, " semaphores were not returned");
+	})
+
+	for(auto& semaphore : semaphores_) vk::destroySemaphore(vkDevice(), semaphore);
+}
+
+PooledSemaphore SemaphorePool::get()
+{
+	LockGuard lock(mutex_);
+
+	//a semaphore is unsignaled again once the wait operation on it completed
+	for(auto it = recycled_.begin(); it != recycled_.end();)
+	{
+		if(vk::getFenceStatus(vkDevice(), it->second) == vk::Result::success)
+		{
+			unused_.push_back(it->first);
+			it = recycled_.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	if(!unused_.empty())
+	{
+		auto semaphore = unused_.back();
+		unused_.pop_back();
+		++reused_;
+		return {*this, semaphore};
+	}
+
+	auto semaphore = vk::createSemaphore(vkDevice(), {});
+	semaphores_.push_back(semaphore);
+	++created_;
+	return {*this, semaphore};
+}
+
+void SemaphorePool::recycle(PooledSemaphore&& semaphore, CommandExecutionState& waiter)
+{
+	if(!semaphore) return;
+
+	waiter.submit();
+	if(!waiter.fence())
+	{
+		VPP_DEBUG_OUTPUT_NOCHECK("vpp::SemaphorePool::recycle: invalid waiter");
+		return; //will be returned by the destructor of semaphore
+	}
+
+	recycle(std::move(semaphore), waiter.fence());
+}
+
+void SemaphorePool::recycle(PooledSemaphore&& semaphore, const FenceRef& fence)
+{
+	if(!semaphore) return;
+
+	LockGuard lock(mutex_);
+	recycled_.emplace_back(semaphore.semaphore_, fence);
+	semaphore.semaphore_ = {};
+}
+
+void SemaphorePool::release(vk::Semaphore semaphore)
+{
+	LockGuard lock(mutex_);
+	unused_.push_back(semaphore);
+}
+
+//CompletionMonitor
+CompletionMonitor::CompletionMonitor(const Device& dev) : Resource(dev)
 {
-	*self_ = this;
 }
 
+CompletionMonitor::~CompletionMonitor()
+{
+	stopThread();
+
+	VPP_DEBUG_CHECK(vpp::~CompletionMonitor,
+	{
+		if(!callbacks_.empty())
+			VPP_DEBUG_OUTPUT(callbacks_.size(), " completion callbacks were never run");
+	})
+}
+
+void CompletionMonitor::add(const FenceRef& fence, Callback callback)
+{
+	{
+		LockGuard lock(mutex_);
+		callbacks_.emplace_back(fence, std::move(callback));
+	}
+
+	threadCV_.notify_one();
+}
+
+void CompletionMonitor::add(const CommandExecutionState& state, Callback callback)
+{
+	//if the state is pending, the callback is added once it is submitted
+	if(state.valid() && device().submitManager().addCallback(state, callback)) return;
+	add(state.fence(), std::move(callback));
+}
+
+std::size_t CompletionMonitor::poll()
+{
+	std::vector<Callback> completed;
+	Executor executor;
+
+	{
+		LockGuard lock(mutex_);
+
+		//callbacks are usually added in batches with the same fence
+		vk::Fence last {};
+		bool signaled = true;
+
+		auto keep = callbacks_.begin();
+		for(auto it = callbacks_.begin(); it != callbacks_.end(); ++it)
+		{
+			auto fence = it->first.vkFence();
+			if(fence != last)
+			{
+				last = fence;
+				signaled = !fence || vk::getFenceStatus(vkDevice(), fence) == vk::Result::success;
+			}
+
+			if(signaled)
+			{
+				completed.push_back(std::move(it->second));
+				continue;
+			}
+
+			if(keep != it) *keep = std::move(*it);
+			++keep;
+		}
+
+		callbacks_.erase(keep, callbacks_.end());
+		executor = executor_;
+	}
+
+	std::exception_ptr error;
+	for(auto& callback : completed)
+	{
+		try
+		{
+			if(executor) executor(std::move(callback));
+			else callback();
+		}
+		catch(...)
+		{
+			if(!error) error = std::current_exception();
+		}
+	}
+
+	if(error) std::rethrow_exception(error);
+	return completed.size();
+}
+
+void CompletionMonitor::executor(Executor executor)
+{
+	LockGuard lock(mutex_);
+	executor_ = std::move(executor);
+}
+
+std::size_t CompletionMonitor::pending() const
+{
+	LockGuard lock(mutex_);
+	return callbacks_.size();
+}
+
+void CompletionMonitor::startThread(std::chrono::nanoseconds interval)
+{
+	interval_.store(interval.count());
+
+	LockGuard lock(mutex_);
+	if(threadRun_.load()) return;
+
+	threadRun_.store(true);
+	thread_ = std::thread(&CompletionMonitor::threadMain, this);
+}
+
+void CompletionMonitor::stopThread()
+{
+	{
+		LockGuard lock(mutex_);
+		if(!threadRun_.load()) return;
+		threadRun_.store(false);
+	}
+
+	threadCV_.notify_one();
+	thread_.join();
+}
+
+void CompletionMonitor::threadMain()
+{
+	std::vector<vk::Fence> fences;
+	while(true)
+	{
+		fences.clear();
+
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			threadCV_.wait(lock, [&]{ return !threadRun_.load() || !callbacks_.empty(); });
+			if(!threadRun_.load()) break;
+
+			for(auto& callback : callbacks_)
+			{
+				auto fence = callback.first.vkFence();
+				if(fence && (fences.empty() || fences.back() != fence)) fences.push_back(fence);
+			}
+		}
+
+		//fences released while waiting are only reset and reused by the pool, never destroyed.
+		//Callbacks added while waiting are noticed after the interval.
+		if(!fences.empty())
+			vk::waitForFences(vkDevice(), fences, false, std::uint64_t(interval_.load()));
+
+		//there is no one to propagate the error to
+		try
+		{
+			poll();
+		}
+		catch(const std::exception& error)
+		{
+			std::cerr << "vpp::CompletionMonitor: monitor thread: " << error.what() << "\n";
+		}
+	}
+}
+
+//ExecutionState
 CommandExecutionState::~CommandExecutionState()
 {
-	if(self_) self_ = nullptr;
+	release();
 }
 
 CommandExecutionState::CommandExecutionState(CommandExecutionState&& other) noexcept
-	: Resource(other), fence_(std::move(other.fence_)), self_(other.self_)
 {
-	if(self_) *self_ = this;
-	other.self_ = nullptr;
+	*this = std::move(other);
 }
 
 CommandExecutionState& CommandExecutionState::operator=(CommandExecutionState&& other) noexcept
 {
-	Resource::init(other.device());
-	if(self_) *self_ = nullptr;
+	if(&other == this) return *this;
+
+	release();
+	resourceBase() = other.resourceBase();
+	if(!other.queue_) return *this;
 
+	LockGuard lock(other.queue_->mutex);
 	fence_ = std::move(other.fence_);
-	self_ = other.self_;
-	if(self_) *self_ = this;
-	other.self_ = nullptr;
+	queue_ = other.queue_;
+	submission_ = other.submission_;
+	id_ = other.id_;
+	submitted_.store(other.submitted_.load());
+	if(submission_) submission_->state = this;
+
+	other.queue_ = nullptr;
+	other.submission_ = nullptr;
+	other.submitted_.store(false);
 
 	return *this;
 }
 
+void CommandExecutionState::init(const Device& dev, SubmitManager::QueueSubmissions& queue,
+	SubmitManager::Submission& submission)
+{
+	release();
+	Resource::init(dev);
+	queue_ = &queue;
+	submission_ = &submission;
+	submission.state = this;
+}
+
+void CommandExecutionState::release()
+{
+	if(queue_)
+	{
+		LockGuard lock(queue_->mutex);
+		if(submission_) submission_->state = nullptr;
+	}
+
+	fence_ = {};
+	queue_ = nullptr;
+	submission_ = nullptr;
+	id_ = 0u;
+	submitted_.store(false);
+}
+
+void CommandExecutionState::markCompleted() const
+{
+	//fences signal in submission order, so all earlier submissions are completed as well
+	auto completed = queue_->completed.load();
+	while(completed < id_ && !queue_->completed.compare_exchange_weak(completed, id_));
+}
+
 void CommandExecutionState::submit()
 {
 	if(submitted()) return;
@@ -79,20 +453,87 @@ void CommandExecutionState::wait(std::uint64_t timeout)
 {
 	if(completed()) return;
 	submit();
-	vk::waitForFences(vkDevice(), 1, *fence_, 0, timeout);
+
+	vk::Fence fence = fence_;
+	auto result = vk::waitForFences(vkDevice(), 1, fence, 0, timeout);
+	if(result == vk::Result::success) markCompleted();
 }
 
 bool CommandExecutionState::submitted() const
 {
-	return (fence_.get());
+	return submitted_.load(std::memory_order_acquire);
 }
 
 bool CommandExecutionState::completed() const
 {
 	if(!submitted()) return false;
+	if(queue_->completed.load() >= id_) return true;
+
+	auto result = vk::getFenceStatus(vkDevice(), fence_);
+	if(result != vk::Result::success) return false;
+
+	markCompleted();
+	return true;
+}
+
+bool waitAll(const Range<const CommandExecutionState*>& states, std::uint64_t timeout)
+{
+	const Device* dev {};
+	for(auto& state : states) if(state->valid()) dev = &state->device();
+	if(!dev) return true;
+
+	//submits every queue only once
+	dev->submitManager().submit(states);
+
+	//states of the same batch share their fence, their status is not queried one by one
+	std::vector<vk::Fence> fences;
+	for(auto& state : states)
+	{
+		if(!state->valid() || state->queue_->completed.load() >= state->id_) continue;
+
+		vk::Fence fence = state->fence_;
+		if(std::find(fences.begin(), fences.end(), fence) == fences.end())
+			fences.push_back(fence);
+	}
 
-	auto result = vk::getFenceStatus(vkDevice(), *fence_);
-	return (result == vk::Result::success);
+	if(fences.empty()) return true;
+
+	auto result = vk::waitForFences(*dev, fences, true, timeout);
+	if(result != vk::Result::success) return false;
+
+	for(auto& state : states) if(state->valid()) state->markCompleted();
+	return true;
+}
+
+int waitAny(const Range<const CommandExecutionState*>& states, std::uint64_t timeout)
+{
+	//checking the states first is cheap when their completion is already known
+	for(auto i = 0u; i < states.size(); ++i)
+		if(states[i]->completed()) return i;
+
+	std::vector<vk::Fence> fences;
+	const Device* dev {};
+	for(auto& state : states)
+	{
+		if(!state->valid()) continue;
+
+		const_cast<CommandExecutionState&>(*state).submit();
+		dev = &state->device();
+
+		vk::Fence fence = state->fence_;
+		if(std::find(fences.begin(), fences.end(), fence) == fences.end())
+			fences.push_back(fence);
+	}
+
+	if(fences.empty()) return -1;
+
+	auto result = vk::waitForFences(*dev, fences, false, timeout);
+	if(result != vk::Result::success) return -1;
+
+	for(auto i = 0u; i < states.size(); ++i)
+		if(states[i]->completed()) return i;
+
+	return -1;
 }
 
 //SubmitManager
@@ -102,153 +543,505 @@ SubmitManager::SubmitManager(const Device& dev) : Resource(dev)
 
 SubmitManager::~SubmitManager()
 {
+	stopThread();
+
+	auto destroy = [](Submission* submission) {
+		while(submission)
+		{
+			auto next = submission->next;
+			delete submission;
+			submission = next;
+		}
+	};
+
+	for(auto& queue : queues_) destroy(queue->pending.exchange(nullptr));
+	destroy(unused_.exchange(nullptr));
+}
+
+void SubmitManager::init()
+{
+	queues_.clear();
+	for(auto& queue : device().queues())
+	{
+		queues_.emplace_back(std::make_unique<QueueSubmissions>());
+		queues_.back()->queue = queue.get();
+		queues_.back()->index = queues_.size() - 1;
+	}
 }
 
 void SubmitManager::submit()
 {
-	while(!submissions_.empty())
-		submit(submissions_.begin()->first);
+	for(auto& queue : queues_) flush(*queue);
 }
 
 void SubmitManager::submit(vk::Queue queue)
 {
-	//lock own mutex and mutex of all queues
-	LockGuard lock(mutex_);
+	flush(queueSubmissions(queue));
+}
 
-	auto it = submissions_.find(queue);
-	if(it == submissions_.end()) return;
+void SubmitManager::add(vk::Queue queue, const vk::SubmitInfo& info, CommandExecutionState* state)
+{
+	auto& submission = allocate();
+	submission.info = info;
+	push(queueSubmissions(queue), submission, state);
+}
 
-	std::vector<vk::SubmitInfo> submitInfos;
-	submitInfos.reserve(it->second.size());
+void SubmitManager::add(vk::Queue queue, const std::vector<vk::CommandBuffer>& bufs,
+	CommandExecutionState* state)
+{
+	auto& submission = allocate();
+	submission.buffers.assign(bufs.begin(), bufs.end());
+	submission.info.commandBufferCount = submission.buffers.size();
+	submission.info.pCommandBuffers = submission.buffers.data();
+	push(queueSubmissions(queue), submission, state);
+}
+
+void SubmitManager::add(vk::Queue queue, vk::CommandBuffer buffer, CommandExecutionState* state)
+{
+	auto& submission = allocate();
+	submission.buffers.push_back(buffer);
+	submission.info.commandBufferCount = 1;
+	submission.info.pCommandBuffers = submission.buffers.data();
+	push(queueSubmissions(queue), submission, state);
+}
 
-	bool createFence = false;
-	for(auto& submission : it->second)
+bool SubmitManager::submit(const CommandExecutionState& state)
+{
+	if(!state.queue_) return false;
+	return flush(*state.queue_, &state);
+}
+
+void SubmitManager::submit(const Range<const CommandExecutionState*>& states)
+{
+	std::vector<QueueSubmissions*> queues;
+	for(auto& state : states)
 	{
-		if(submission.state && *submission.state) createFence = true;
-		submitInfos.push_back(submission.info);
+		if(!state->valid() || state->submitted()) continue;
+		if(std::find(queues.begin(), queues.end(), state->queue_) == queues.end())
+			queues.push_back(state->queue_);
 	}
 
-	std::shared_ptr<Fence> fence;
-	vk::FenceCreateInfo fenceInfo {};
+	for(auto& queue : queues) flush(*queue);
+}
+
+void SubmitManager::bindSparse(const Queue& queue, const Range<vk::BindSparseInfo>& infos,
+	vk::Fence fence)
+{
+	auto&& lock = acquire(queue);
+	vk::queueBindSparse(queue, infos, fence);
+}
+
+SubmitManager::Lock SubmitManager::acquire(const Queue& queue) const
+{
+	return {device(), queue};
+}
+
+SubmitManager::Lock SubmitManager::acquire() const
+{
+	return {device()};
+}
+
+SubmitManager::QueueSubmissions& SubmitManager::queueSubmissions(vk::Queue queue)
+{
+	for(auto& q : queues_) if(q->queue->vkQueue() == queue) return *q;
+	throw std::logic_error("vpp::SubmitManager: the given queue does not belong to the device");
+}
+
+SubmitManager::QueueSubmissions& SubmitManager::queueSubmissions(const Queue& queue)
+{
+	for(auto& q : queues_) if(q->queue == &queue) return *q;
+	throw std::logic_error("vpp::SubmitManager: the given queue does not belong to the device");
+}
 
+SubmitManager::Submission& SubmitManager::allocate()
+{
+	//the nodes are not bound to a SubmitManager so the cache can be shared
+	thread_local std::vector<std::unique_ptr<Submission>> cache;
+
+	//taking all unused nodes at once avoids the aba problem of a lock-free pop
+	if(cache.empty())
 	{
-		auto&& lock = acquire();
-		if(createFence)
+		auto node = unused_.exchange(nullptr, std::memory_order_acquire);
+		while(node)
 		{
-			fence = std::make_shared<Fence>(device(), fenceInfo);
-			vk::queueSubmit(queue, submitInfos, *fence);
+			auto next = node->next;
+			cache.emplace_back(node);
+			node = next;
 		}
-		else
+	}
+
+	if(cache.empty()) return *new Submission();
+
+	auto ret = cache.back().release();
+	cache.pop_back();
+	return *ret;
+}
+
+void SubmitManager::push(QueueSubmissions& queue, Submission& submission,
+	CommandExecutionState* state)
+{
+	//the submission is not yet visible to other threads
+	if(state) state->init(device(), queue, submission);
+	submission.order = queue.order++;
+
+	//a failed exchange updates next, so whether this is the first pending submission
+	//(that starts the latency deadline) must be checked again in every iteration.
+	//The time is stored before the submission becomes visible to the thread
+	submission.next = queue.pending.load(std::memory_order_relaxed);
+	do
+	{
+		if(!submission.next) queue.since.store(Clock::now().time_since_epoch().count());
+	}
+	while(!queue.pending.compare_exchange_weak(submission.next, &submission,
+		std::memory_order_release, std::memory_order_relaxed));
+
+	int count = submission.info.commandBufferCount;
+	count += queue.bufferCount.fetch_add(count);
+
+	//the thread only has to be woken up if its deadline or the batch size changed
+	if(threadRun_.load() && (!submission.next || count >= int(batchSize_.load())))
+		notifyThread();
+}
+
+bool SubmitManager::addDependency(const CommandExecutionState& waiting,
+	const CommandExecutionState& signal, vk::PipelineStageFlags stage)
+{
+	if(!signal.valid() || signal.completed()) return true;
+	if(!waiting.valid())
+		throw std::logic_error("vpp::SubmitManager::addDependency: invalid waiting state");
+
+	auto& wqueue = *waiting.queue_;
+	auto& squeue = *signal.queue_;
+
+	std::unique_lock<std::mutex> wlock(wqueue.mutex, std::defer_lock);
+	std::unique_lock<std::mutex> slock(squeue.mutex, std::defer_lock);
+	if(&wqueue == &squeue) wlock.lock();
+	else std::lock(wlock, slock);
+
+	if(!waiting.submission_)
+		throw std::logic_error("vpp::SubmitManager::addDependency: waiting state already submitted");
+
+	//if the dependency was already submitted to another queue, the caller has to wait for it
+	if(!signal.submission_) return &wqueue == &squeue;
+
+	if(&wqueue == &squeue && signal.submission_->order > waiting.submission_->order)
+		throw std::logic_error("vpp::SubmitManager::addDependency: the dependency was added "
+			"after the waiting submission to the same queue");
+
+	//the order is assigned before a submission is pushed, so the signal submission might
+	//still be pushed by another thread and then be flushed after the waiting one (or after
+	//the semaphore is waited on). Pending submissions are only taken by flush with the
+	//mutex locked, so once it is reachable it is submitted before or together with the
+	//waiting one. Pushing does not need the mutex, so waiting for it cannot deadlock
+	auto pending = [&]{
+		auto node = squeue.pending.load(std::memory_order_acquire);
+		for(; node; node = node->next) if(node == signal.submission_) return true;
+		return false;
+	};
+
+	while(!pending()) std::this_thread::yield();
+
+	//within one queue the submission order is enough
+	if(&wqueue == &squeue) return true;
+
+	const auto wbit = std::uint64_t(1) << wqueue.index;
+	const auto sbit = std::uint64_t(1) << squeue.index;
+	if(squeue.dependencies.load() & wbit)
+		throw std::logic_error("vpp::SubmitManager::addDependency: pending cyclic dependency "
+			"between two queues");
+
+	auto semaphore = device().semaphorePool().get();
+	signal.submission_->signalSemaphores.push_back(semaphore);
+	waiting.submission_->waitSemaphores.push_back(semaphore);
+	waiting.submission_->waitStages.push_back(stage);
+	waiting.submission_->semaphores.push_back(std::move(semaphore));
+	wqueue.dependencies |= sbit;
+
+	return true;
+}
+
+bool SubmitManager::addCallback(const CommandExecutionState& state,
+	CompletionMonitor::Callback& callback)
+{
+	LockGuard lock(state.queue_->mutex);
+	if(!state.submission_) return false;
+
+	state.submission_->callbacks.push_back(std::move(callback));
+	return true;
+}
+
+bool SubmitManager::flush(QueueSubmissions& queue, const CommandExecutionState* state)
+{
+	std::unique_lock<std::mutex> lock(queue.mutex, std::defer_lock);
+
+	//the queues with submissions signaling semaphores the pending submissions of this
+	//queue wait on have to be flushed first. Dependencies are only added while the mutex is
+	//locked, so after locking there are no new ones as long as the bitmask is empty.
+	while(true)
+	{
+		auto dependencies = queue.dependencies.exchange(0u);
+		for(auto i = 0u; dependencies; ++i, dependencies >>= 1)
+			if(dependencies & 1u) flush(*queues_[i]);
+
+		lock.lock();
+		if(!queue.dependencies.load()) break;
+		lock.unlock();
+	}
+
+	//check if the state was already submitted by another thread
+	if(state && !state->submission_) return false;
+
+	auto node = queue.pending.exchange(nullptr, std::memory_order_acquire);
+	if(!node) return false;
+
+	//restore the order in which the submissions were added
+	queue.submissions.clear();
+	for(; node; node = node->next) queue.submissions.push_back(node);
+	std::sort(queue.submissions.begin(), queue.submissions.end(),
+		[](const Submission* a, const Submission* b) { return a->order < b->order; });
+
+	queue.infos.clear();
+	bool fenceNeeded = false;
+	int bufferCount = 0;
+	for(auto& submission : queue.submissions)
+	{
+		//the submit info of the submission is not changed, so it can be flushed again
+		//if the submission fails
+		auto info = submission->info;
+		if(submission->state || !submission->semaphores.empty() || !submission->callbacks.empty())
+			fenceNeeded = true;
+		bufferCount += info.commandBufferCount;
+
+		//the semaphores given in the submit info come first
+		auto& waits = submission->waitSemaphores;
+		auto& stages = submission->waitStages;
+		if(!waits.empty())
 		{
-			vk::queueSubmit(queue, submitInfos);
+			waits.insert(waits.begin(), info.pWaitSemaphores,
+				info.pWaitSemaphores + info.waitSemaphoreCount);
+			stages.insert(stages.begin(), info.pWaitDstStageMask,
+				info.pWaitDstStageMask + info.waitSemaphoreCount);
+
+			info.waitSemaphoreCount = waits.size();
+			info.pWaitSemaphores = waits.data();
+			info.pWaitDstStageMask = stages.data();
 		}
+
+		auto& signals = submission->signalSemaphores;
+		if(!signals.empty())
+		{
+			signals.insert(signals.begin(), info.pSignalSemaphores,
+				info.pSignalSemaphores + info.signalSemaphoreCount);
+
+			info.signalSemaphoreCount = signals.size();
+			info.pSignalSemaphores = signals.data();
+		}
+
+		queue.infos.push_back(info);
 	}
 
-	if(createFence)
+	FenceRef fence;
+	try
+	{
+		if(fenceNeeded) fence = device().fencePool().get();
+
+		auto&& lock = acquire(*queue.queue);
+		vk::queueSubmit(*queue.queue, queue.infos, fence);
+	}
+	catch(...)
 	{
-		for(auto& submission : it->second)
+		//the submissions stay pending, so their states can still be submitted
+		restore(queue);
+		throw;
+	}
+
+	queue.bufferCount -= bufferCount;
+	auto id = ++queue.submitted;
+
+	for(auto& submission : queue.submissions)
+	{
+		if(submission->state)
 		{
-			if(submission.state && *submission.state)
-				(*submission.state)->fence_ = fence;
+			auto& subState = *submission->state;
+			subState.fence_ = fence;
+			subState.id_ = id;
+			subState.submission_ = nullptr;
+			subState.submitted_.store(true, std::memory_order_release);
 		}
+
+		for(auto& semaphore : submission->semaphores)
+			device().semaphorePool().recycle(std::move(semaphore), fence);
+
+		for(auto& callback : submission->callbacks)
+			device().completionMonitor().add(fence, std::move(callback));
+
+		submission->info = {};
+		submission->buffers.clear();
+		submission->state = nullptr;
+		submission->waitSemaphores.clear();
+		submission->waitStages.clear();
+		submission->signalSemaphores.clear();
+		submission->semaphores.clear();
+		submission->callbacks.clear();
 	}
 
-	submissions_.erase(it);
+	//return the nodes as one chain
+	auto& first = *queue.submissions.front();
+	auto& last = *queue.submissions.back();
+	for(auto i = 1u; i < queue.submissions.size(); ++i)
+		queue.submissions[i - 1]->next = queue.submissions[i];
+
+	last.next = unused_.load(std::memory_order_relaxed);
+	while(!unused_.compare_exchange_weak(last.next, &first,
+		std::memory_order_release, std::memory_order_relaxed));
+
+	return true;
 }
 
-void SubmitManager::add(vk::Queue queue, const vk::SubmitInfo& info, CommandExecutionState* state)
+void SubmitManager::restore(QueueSubmissions& queue)
 {
-	Submission submission;
-	submission.info = info;
-	if(state)
+	//remove the semaphores of the submit infos again that were merged with the
+	//semaphores of the dependencies in flush
+	for(auto& submission : queue.submissions)
 	{
-		submission.state = std::make_unique<CommandExecutionState*>();
-		*state = {device(), submission.state.get()};
+		auto& info = submission->info;
+		auto& waits = submission->waitSemaphores;
+		auto& stages = submission->waitStages;
+		auto& signals = submission->signalSemaphores;
+		if(!waits.empty())
+		{
+			waits.erase(waits.begin(), waits.begin() + info.waitSemaphoreCount);
+			stages.erase(stages.begin(), stages.begin() + info.waitSemaphoreCount);
+		}
+
+		if(!signals.empty())
+			signals.erase(signals.begin(), signals.begin() + info.signalSemaphoreCount);
 	}
 
-	LockGuard lock(mutex_);
-	submissions_[queue].emplace_back(std::move(submission));
+	//push them back as one chain, the order is restored on the next flush
+	for(auto i = 1u; i < queue.submissions.size(); ++i)
+		queue.submissions[i - 1]->next = queue.submissions[i];
+
+	auto& first = *queue.submissions.front();
+	auto& last = *queue.submissions.back();
+	last.next = queue.pending.load(std::memory_order_relaxed);
+	while(!queue.pending.compare_exchange_weak(last.next, &first,
+		std::memory_order_release, std::memory_order_relaxed));
 }
 
-void SubmitManager::add(vk::Queue queue, const std::vector<vk::CommandBuffer>& bufs,
-	CommandExecutionState* state)
+void SubmitManager::startThread(unsigned int batchSize, std::chrono::nanoseconds latency)
 {
-	Submission submission;
-	submission.buffers = bufs;
-	if(state)
+	batchSize_.store(batchSize);
+	latency_.store(latency.count());
+
+	LockGuard lock(threadMutex_);
+	if(threadRun_.load())
 	{
-		submission.state = std::make_unique<CommandExecutionState*>();
-		*state = {device(), submission.state.get()};
+		threadCV_.notify_one();
+		return;
 	}
 
-	vk::SubmitInfo info;
-	info.commandBufferCount = submission.buffers.size();
-	info.pCommandBuffers = submission.buffers.data();
-
-	submission.info = info;
-
-	LockGuard lock(mutex_);
-	submissions_[queue].emplace_back(std::move(submission));
+	threadRun_.store(true);
+	thread_ = std::thread(&SubmitManager::threadMain, this);
 }
 
-void SubmitManager::add(vk::Queue queue, vk::CommandBuffer buffer, CommandExecutionState* state)
+void SubmitManager::stopThread()
 {
-	Submission submission;
-	submission.buffers = {buffer};
-	if(state)
 	{
-		submission.state = std::make_unique<CommandExecutionState*>();
-		*state = {device(), submission.state.get()};
+		LockGuard lock(threadMutex_);
+		if(!threadRun_.load()) return;
+		threadRun_.store(false);
 	}
 
-	vk::SubmitInfo info;
-	info.commandBufferCount = submission.buffers.size();
-	info.pCommandBuffers = submission.buffers.data();
+	threadCV_.notify_one();
+	thread_.join();
+}
 
-	submission.info = info;
+void SubmitManager::notifyThread()
+{
+	//the thread rescans the queues instead of waiting if it was notified during
+	//its last scan, so the notification cannot be missed
+	{
+		LockGuard lock(threadMutex_);
+		threadNotified_ = true;
+	}
 
-	LockGuard lock(mutex_);
-	submissions_[queue].emplace_back(std::move(submission));
+	threadCV_.notify_one();
 }
 
-bool SubmitManager::submit(const CommandExecutionState& id)
+void SubmitManager::threadMain()
 {
-	std::unique_lock<std::mutex> lock(mutex_);
-
-	for(auto& ent : submissions_)
+	std::unique_lock<std::mutex> lock(threadMutex_);
+	while(threadRun_.load())
 	{
-		auto it = std::find_if(ent.second.begin(), ent.second.end(),
-			[&](const Submission& subm) { return(subm.state && *subm.state == &id); });
+		threadNotified_ = false;
+		lock.unlock();
 
-		if(it != ent.second.end())
+		auto now = Clock::now();
+		auto latency = std::chrono::nanoseconds(latency_.load());
+		auto batchSize = int(batchSize_.load());
+
+		//flush all queues that reached one of the thresholds
+		//remember the next deadline of the others
+		bool pending = false;
+		auto wakeup = Clock::time_point::max();
+		for(auto& queue : queues_)
 		{
-			lock.unlock(); //the next submit call will lock it again.
-			submit(ent.first);
-			return true;
+			if(!queue->pending.load()) continue;
+
+			auto deadline = Clock::time_point(Clock::duration(queue->since.load())) + latency;
+			if(queue->bufferCount.load() >= batchSize || deadline <= now)
+			{
+				//there is no one to propagate the error to
+				try
+				{
+					flush(*queue);
+				}
+				catch(const std::exception& error)
+				{
+					std::cerr << "vpp::SubmitManager: submission thread: " << error.what() << "\n";
+
+					//the submissions stay pending, try again after the latency
+					pending = true;
+					wakeup = std::min(wakeup, now + latency);
+				}
+			}
+			else
+			{
+				pending = true;
+				wakeup = std::min(wakeup, deadline);
+			}
 		}
-	}
 
-#ifndef NDEBUG
-	std::cerr << "vpp::SubmitManager::submit: could not find the given commandSubmission\n";
-#endif
+		lock.lock();
+		if(!threadRun_.load()) break;
 
-	return false;
-}
+		//submissions added during the scan notified without the thread waiting,
+		//they might have to be submitted before the computed wakeup
+		if(threadNotified_) continue;
 
-SubmitManager::Lock SubmitManager::acquire() const
-{
-	return {device()};
+		//pending is only true if wakeup was set to a deadline
+		if(pending) threadCV_.wait_until(lock, std::max(wakeup, now));
+		else threadCV_.wait(lock);
+	}
 }
 
 //Lock
 SubmitManager::Lock::Lock(const Device& dev) : Resource(dev)
 {
+	//always locked in the same order so there can be no deadlock
 	for(auto& q : device().queues()) q->mutex().lock();
 }
 
+SubmitManager::Lock::Lock(const Device& dev, const Queue& queue) : Resource(dev), queue_(&queue)
+{
+	queue.mutex().lock();
+}
+
 SubmitManager::Lock::~Lock()
 {
-	for(auto& q : device().queues()) q->mutex().unlock();
+	if(queue_) queue_->mutex().unlock();
+	else for(auto& q : device().queues()) q->mutex().unlock();
 }
 
 }
@@ -2,6 +2,7 @@
 #include <vpp/vk.hpp>
 #include <vpp/procAddr.hpp>
 #include <vpp/queue.hpp>
+#include <vpp/submit.hpp>
 #include <vpp/surface.hpp>
 #include <vpp/image.hpp>
 #include <vpp/utility/debug.hpp>
@@ -394,7 +395,7 @@ vk::Result SwapChain::present(const Queue& queue, std::uint32_t currentBuffer,
 		presentInfo.pWaitSemaphores = &wait;
 	}
 
-	std::lock_guard<std::mutex> guard(queue.mutex());
+	auto&& lock = device().submitManager().acquire(queue);
 	auto ret = pfQueuePresentKHR(queue, &presentInfo);
 
 	return ret;
@@ -0,0 +1,418 @@
+#include <vpp/sync.hpp>
+#include <vpp/vk.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace vpp
+{
+
+namespace
+{
+
+constexpr vk::AccessFlags writeAccessBits = vk::AccessBits::shaderWrite |
+	vk::AccessBits::colorAttachmentWrite | vk::AccessBits::depthStencilAttachmentWrite |
+	vk::AccessBits::transferWrite | vk::AccessBits::hostWrite | vk::AccessBits::memoryWrite;
+
+constexpr auto bufferEnd = std::numeric_limits<vk::DeviceSize>::max();
+
+bool contains(vk::AccessFlags flags, vk::AccessFlags sub) { return (flags & sub) == sub; }
+bool contains(vk::PipelineStageFlags flags, vk::PipelineStageFlags sub)
+	{ return (flags & sub) == sub; }
+
+}
+
+vk::AccessFlags layoutAccess(vk::ImageLayout layout)
+{
+	switch(layout)
+	{
+		case vk::ImageLayout::general:
+			return vk::AccessBits::memoryRead | vk::AccessBits::memoryWrite;
+		case vk::ImageLayout::colorAttachmentOptimal:
+			return vk::AccessBits::colorAttachmentRead | vk::AccessBits::colorAttachmentWrite;
+		case vk::ImageLayout::depthStencilAttachmentOptimal:
+			return vk::AccessBits::depthStencilAttachmentRead |
+				vk::AccessBits::depthStencilAttachmentWrite;
+		case vk::ImageLayout::depthStencilReadOnlyOptimal:
+			return vk::AccessBits::depthStencilAttachmentRead | vk::AccessBits::shaderRead;
+		case vk::ImageLayout::shaderReadOnlyOptimal:
+			return vk::AccessBits::shaderRead | vk::AccessBits::inputAttachmentRead;
+		case vk::ImageLayout::transferSrcOptimal: return vk::AccessBits::transferRead;
+		case vk::ImageLayout::transferDstOptimal: return vk::AccessBits::transferWrite;
+		case vk::ImageLayout::preinitialized: return vk::AccessBits::hostWrite;
+		default: return {};
+	}
+}
+
+vk::AccessFlags writeAccess(vk::AccessFlags access)
+{
+	return access & writeAccessBits;
+}
+
+vk::PipelineStageFlags accessStages(vk::AccessFlags access, vk::QueueFlags queueFlags)
+{
+	const bool graphics = (queueFlags & vk::QueueBits::graphics);
+	const bool compute = (queueFlags & vk::QueueBits::compute);
+
+	vk::PipelineStageFlags ret {};
+	bool unsupported = false;
+	auto add = [&](vk::AccessFlags bits, vk::PipelineStageFlags stages, bool supported) {
+		if(!(access & bits)) return;
+		if(supported) ret |= stages;
+		else unsupported = true;
+	};
+
+	vk::PipelineStageFlags shaderStages {};
+	if(graphics) shaderStages |= vk::PipelineStageBits::vertexShader |
+		vk::PipelineStageBits::fragmentShader;
+	if(compute) shaderStages |= vk::PipelineStageBits::computeShader;
+
+	add(vk::AccessBits::indirectCommandRead, vk::PipelineStageBits::drawIndirect,
+		graphics || compute);
+	add(vk::AccessBits::indexRead | vk::AccessBits::vertexAttributeRead,
+		vk::PipelineStageBits::vertexInput, graphics);
+	add(vk::AccessBits::uniformRead | vk::AccessBits::shaderRead | vk::AccessBits::shaderWrite,
+		shaderStages, graphics || compute);
+	add(vk::AccessBits::inputAttachmentRead, vk::PipelineStageBits::fragmentShader, graphics);
+	add(vk::AccessBits::colorAttachmentRead | vk::AccessBits::colorAttachmentWrite,
+		vk::PipelineStageBits::colorAttachmentOutput, graphics);
+	add(vk::AccessBits::depthStencilAttachmentRead | vk::AccessBits::depthStencilAttachmentWrite,
+		vk::PipelineStageBits::earlyFragmentTests | vk::PipelineStageBits::lateFragmentTests,
+		graphics);
+	add(vk::AccessBits::transferRead | vk::AccessBits::transferWrite,
+		vk::PipelineStageBits::transfer, true);
+	add(vk::AccessBits::hostRead | vk::AccessBits::hostWrite, vk::PipelineStageBits::host, true);
+	add(vk::AccessBits::memoryRead | vk::AccessBits::memoryWrite,
+		vk::PipelineStageBits::allCommands, true);
+
+	if(unsupported) ret |= vk::PipelineStageBits::allCommands;
+	return ret;
+}
+
+//ResourceStateTracker
+ResourceStateTracker::ResourceStateTracker(vk::QueueFlags queueFlags) : queueFlags_(queueFlags)
+{
+}
+
+void ResourceStateTracker::track(vk::Image image, unsigned int levels, unsigned int layers,
+	vk::ImageAspectFlags aspects, vk::ImageLayout layout)
+{
+	State state;
+	state.layout = layout;
+	track(image, levels, layers, aspects, state);
+}
+
+void ResourceStateTracker::track(vk::Image image, unsigned int levels, unsigned int layers,
+	vk::ImageAspectFlags aspects, const State& state)
+{
+	auto& img = images_[image];
+	img.levels = levels;
+	img.layers = layers;
+	img.aspects = aspects;
+	img.subresources.clear();
+	img.subresources.resize(levels * layers, {state, {}});
+}
+
+void ResourceStateTracker::track(vk::Buffer buffer, const State& state)
+{
+	auto& ranges = buffers_[buffer];
+	ranges.clear();
+	ranges.push_back({0, bufferEnd, {state, {}}});
+}
+
+void ResourceStateTracker::use(vk::Image image, const vk::ImageSubresourceRange& range,
+	vk::ImageLayout layout, vk::AccessFlags access, vk::PipelineStageFlags stages)
+{
+	auto it = images_.find(image);
+	if(it == images_.end())
+		throw std::logic_error("vpp::ResourceStateTracker::use: image is not tracked");
+
+	auto& img = it->second;
+	auto levelEnd = (range.levelCount == vk::remainingMipLevels) ? img.levels :
+		std::min(img.levels, range.baseMipLevel + range.levelCount);
+	auto layerEnd = (range.layerCount == vk::remainingArrayLayers) ? img.layers :
+		std::min(img.layers, range.baseArrayLayer + range.layerCount);
+
+	if(!stages) stages = accessStages(access, queueFlags_);
+	for(auto level = range.baseMipLevel; level < levelEnd; ++level)
+		for(auto layer = range.baseArrayLayer; layer < layerEnd; ++layer)
+			use(img.subresources[level * img.layers + layer], layout, access, stages);
+}
+
+void ResourceStateTracker::use(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size,
+	vk::AccessFlags access, vk::PipelineStageFlags stages)
+{
+	auto end = (size == vk::wholeSize) ? bufferEnd : offset + size;
+	if(end <= offset) return;
+
+	auto& ranges = buffers_[buffer];
+	split(ranges, offset);
+	split(ranges, end);
+
+	if(!stages) stages = accessStages(access, queueFlags_);
+	auto it = std::lower_bound(ranges.begin(), ranges.end(), offset,
+		[](const BufferRange& r, vk::DeviceSize o) { return r.end <= o; });
+
+	//untracked parts of the range are inserted unused
+	auto pos = offset;
+	while(pos < end)
+	{
+		if(it == ranges.end() || it->offset > pos)
+		{
+			auto gapEnd = (it == ranges.end()) ? end : std::min(end, it->offset);
+			it = ranges.insert(it, {pos, gapEnd, {}});
+		}
+
+		use(it->state, {}, access, stages);
+		pos = it->end;
+		++it;
+	}
+}
+
+void ResourceStateTracker::use(Subresource& sub, vk::ImageLayout layout, vk::AccessFlags access,
+	vk::PipelineStageFlags stages)
+{
+	auto& pending = sub.pending;
+	if(pending.valid)
+	{
+		//no commands in between, so they can simply wait for the same barrier
+		pending.layout = layout;
+		pending.access |= access;
+		pending.stages |= stages;
+		return;
+	}
+
+	auto& state = sub.state;
+	auto write = writeAccess(access);
+	auto transition = layout != state.layout;
+
+	bool needed;
+	if(write || transition) needed = transition || state.writeStages || state.readStages;
+	else needed = state.writeStages && (!contains(state.readStages, stages) ||
+		!contains(state.readAccess, access));
+
+	if(!needed)
+	{
+		if(write)
+		{
+			state.writeAccess = write;
+			state.writeStages = stages;
+			state.readAccess = {};
+			state.readStages = {};
+		}
+		else
+		{
+			state.readAccess |= access;
+			state.readStages |= stages;
+		}
+
+		return;
+	}
+
+	pending.valid = true;
+	pending.layout = layout;
+	pending.access = access;
+	pending.stages = stages;
+	pending_ = true;
+}
+
+void ResourceStateTracker::split(std::vector<BufferRange>& ranges, vk::DeviceSize at)
+{
+	auto it = std::lower_bound(ranges.begin(), ranges.end(), at,
+		[](const BufferRange& r, vk::DeviceSize o) { return r.end <= o; });
+	if(it == ranges.end() || it->offset >= at) return;
+
+	auto copy = *it;
+	it->end = at;
+	copy.offset = at;
+	ranges.insert(it + 1, copy);
+}
+
+unsigned int ResourceStateTracker::flush(vk::CommandBuffer cmdBuffer)
+{
+	if(!pending_) return 0;
+
+	vk::PipelineStageFlags srcStages {};
+	vk::PipelineStageFlags dstStages {};
+	imageBarriers_.clear();
+	bufferBarriers_.clear();
+
+	//computes the barrier for a subresource and applies the pending use to its state
+	auto apply = [&](Subresource& sub, vk::AccessFlags& srcAccess, vk::AccessFlags& dstAccess,
+			vk::ImageLayout& oldLayout) {
+		auto& state = sub.state;
+		auto& pending = sub.pending;
+		auto write = writeAccess(pending.access);
+		auto transition = pending.layout != state.layout;
+
+		srcStages |= state.writeStages;
+		if(write || transition) srcStages |= state.readStages;
+		dstStages |= pending.stages;
+
+		srcAccess = state.writeAccess;
+		dstAccess = pending.access;
+		oldLayout = state.layout;
+
+		state.layout = pending.layout;
+		if(write)
+		{
+			state.writeAccess = write;
+			state.writeStages = pending.stages;
+			state.readAccess = {};
+			state.readStages = {};
+		}
+		else if(transition)
+		{
+			//the layout transition is a write made visible to the given use
+			state.writeAccess = {};
+			state.writeStages = pending.stages;
+			state.readAccess = pending.access;
+			state.readStages = pending.stages;
+		}
+		else
+		{
+			state.readAccess |= pending.access;
+			state.readStages |= pending.stages;
+		}
+
+		pending = {};
+	};
+
+	for(auto& entry : images_)
+	{
+		auto& img = entry.second;
+		for(auto level = 0u; level < img.levels; ++level)
+		{
+			for(auto layer = 0u; layer < img.layers; ++layer)
+			{
+				auto& sub = img.subresources[level * img.layers + layer];
+				if(!sub.pending.valid) continue;
+
+				vk::ImageMemoryBarrier barrier;
+				barrier.newLayout = sub.pending.layout;
+				barrier.srcQueueFamilyIndex = vk::queueFamilyIgnored;
+				barrier.dstQueueFamilyIndex = vk::queueFamilyIgnored;
+				barrier.image = entry.first;
+				barrier.subresourceRange = {img.aspects, level, 1, layer, 1};
+				apply(sub, barrier.srcAccessMask, barrier.dstAccessMask, barrier.oldLayout);
+
+				//merge with the previous barrier for the adjacent layer or level if possible
+				if(!imageBarriers_.empty())
+				{
+					auto& prev = imageBarriers_.back();
+					auto& pr = prev.subresourceRange;
+					auto same = prev.image == barrier.image &&
+						prev.oldLayout == barrier.oldLayout && prev.newLayout == barrier.newLayout &&
+						prev.srcAccessMask == barrier.srcAccessMask &&
+						prev.dstAccessMask == barrier.dstAccessMask;
+
+					if(same && pr.baseMipLevel == level && pr.levelCount == 1 &&
+						pr.baseArrayLayer + pr.layerCount == layer)
+					{
+						++pr.layerCount;
+						continue;
+					}
+				}
+
+				imageBarriers_.push_back(barrier);
+			}
+
+			//merge the barriers of this level with the ones of the previous level
+			if(imageBarriers_.size() >= 2)
+			{
+				auto& last = imageBarriers_.back();
+				auto& prev = imageBarriers_[imageBarriers_.size() - 2];
+				auto& lr = last.subresourceRange;
+				auto& pr = prev.subresourceRange;
+				if(last.subresourceRange.baseMipLevel == level && prev.image == last.image &&
+					prev.oldLayout == last.oldLayout && prev.newLayout == last.newLayout &&
+					prev.srcAccessMask == last.srcAccessMask &&
+					prev.dstAccessMask == last.dstAccessMask &&
+					pr.baseArrayLayer == lr.baseArrayLayer && pr.layerCount == lr.layerCount &&
+					pr.baseMipLevel + pr.levelCount == level)
+				{
+					++pr.levelCount;
+					imageBarriers_.pop_back();
+				}
+			}
+		}
+	}
+
+	for(auto& entry : buffers_)
+	{
+		auto& ranges = entry.second;
+		for(auto& range : ranges)
+		{
+			if(!range.state.pending.valid) continue;
+
+			vk::BufferMemoryBarrier barrier;
+			barrier.srcQueueFamilyIndex = vk::queueFamilyIgnored;
+			barrier.dstQueueFamilyIndex = vk::queueFamilyIgnored;
+			barrier.buffer = entry.first;
+			barrier.offset = range.offset;
+			barrier.size = (range.end == bufferEnd) ? vk::wholeSize : range.end - range.offset;
+
+			vk::ImageLayout layout;
+			apply(range.state, barrier.srcAccessMask, barrier.dstAccessMask, layout);
+			bufferBarriers_.push_back(barrier);
+		}
+
+		//merge adjacent ranges with the same state to keep the number of ranges small
+		auto equal = [](const State& a, const State& b) {
+			return a.writeAccess == b.writeAccess && a.writeStages == b.writeStages &&
+				a.readAccess == b.readAccess && a.readStages == b.readStages;
+		};
+
+		if(ranges.empty()) continue;
+
+		auto out = ranges.begin();
+		for(auto it = ranges.begin() + 1; it < ranges.end(); ++it)
+		{
+			if(out->end == it->offset && !it->state.pending.valid &&
+				!out->state.pending.valid && equal(out->state.state, it->state.state))
+			{
+				out->end = it->end;
+				continue;
+			}
+
+			*(++out) = *it;
+		}
+
+		ranges.erase(out + 1, ranges.end());
+	}
+
+	if(!srcStages) srcStages = vk::PipelineStageBits::topOfPipe;
+	if(!dstStages) dstStages = vk::PipelineStageBits::bottomOfPipe;
+
+	vk::cmdPipelineBarrier(cmdBuffer, srcStages, dstStages, {}, {}, bufferBarriers_,
+		imageBarriers_);
+
+	pending_ = false;
+	return imageBarriers_.size() + bufferBarriers_.size();
+}
+
+ResourceStateTracker::State ResourceStateTracker::state(vk::Image image, unsigned int level,
+	unsigned int layer) const
+{
+	auto it = images_.find(image);
+	if(it == images_.end())
+		throw std::logic_error("vpp::ResourceStateTracker::state: image is not tracked");
+
+	auto& sub = it->second.subresources.at(level * it->second.layers + layer);
+	auto ret = sub.state;
+	if(sub.pending.valid) ret.layout = sub.pending.layout;
+	return ret;
+}
+
+void ResourceStateTracker::forget(vk::Image image)
+{
+	images_.erase(image);
+}
+
+void ResourceStateTracker::forget(vk::Buffer buffer)
+{
+	buffers_.erase(buffer);
+}
+
+}
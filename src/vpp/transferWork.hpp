@@ -33,7 +33,7 @@ public:
 	{
 		finish();
 		downloadWork_ = retrieve(transferRange_.buffer());
-		return downloadWork_->data();
+		return *(&downloadWork_->data() + transferRange_.offset());
 	}
 
 public:
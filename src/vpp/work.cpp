@@ -1,8 +1,119 @@
 #include <vpp/work.hpp>
 
+#include <vector>
+#include <array>
+#include <stdexcept>
+
 namespace vpp
 {
 
+namespace
+{
+
+constexpr auto workBlockSize = 64u;
+constexpr auto workBlockClasses = 8u; //works up to 512 bytes are cached
+constexpr auto maxCachedWorkBlocks = 64u; //per size class and thread
+
+struct WorkBlock
+{
+	WorkBlock* next;
+};
+
+//Thread local cache of free work memory blocks for every size class.
+//All blocks come from the global operator new, so they can be freed on any thread.
+struct WorkBlockCache
+{
+	std::array<WorkBlock*, workBlockClasses> free {};
+	std::array<unsigned int, workBlockClasses> count {};
+
+	~WorkBlockCache()
+	{
+		for(auto block : free)
+		{
+			while(block)
+			{
+				auto next = block->next;
+				::operator delete(block);
+				block = next;
+			}
+		}
+	}
+};
+
+thread_local WorkBlockCache workBlockCache;
+
+unsigned int workBlockClass(std::size_t size)
+{
+	return size ? (size - 1) / workBlockSize : 0u;
+}
+
+}
+
+//WorkBase
+void* WorkBase::operator new(std::size_t size)
+{
+	auto id = workBlockClass(size);
+	if(id >= workBlockClasses) return ::operator new(size);
+
+	auto& cache = workBlockCache;
+	if(auto block = cache.free[id])
+	{
+		cache.free[id] = block->next;
+		--cache.count[id];
+		return block;
+	}
+
+	return ::operator new((id + 1) * workBlockSize);
+}
+
+void WorkBase::operator delete(void* ptr, std::size_t size)
+{
+	if(!ptr) return;
+
+	auto id = workBlockClass(size);
+	auto& cache = workBlockCache;
+	if(id >= workBlockClasses || cache.count[id] >= maxCachedWorkBlocks)
+	{
+		::operator delete(ptr);
+		return;
+	}
+
+	auto block = static_cast<WorkBlock*>(ptr);
+	block->next = cache.free[id];
+	cache.free[id] = block;
+	++cache.count[id];
+}
+
+void WorkBase::after(WorkBase& other, vk::PipelineStageFlags stage)
+{
+	auto signal = other.executionState();
+	if(!signal)
+	{
+		other.wait();
+		return;
+	}
+
+	auto waiting = executionState();
+	if(!waiting || !waiting->valid())
+		throw std::logic_error("vpp::WorkBase::after: work has no execution state");
+
+	if(!waiting->device().submitManager().addDependency(*waiting, *signal, stage))
+		other.wait();
+}
+
+void WorkBase::then(std::function<void()> callback)
+{
+	auto state = executionState();
+	if(!state || !state->valid())
+	{
+		wait();
+		callback();
+		return;
+	}
+
+	state->device().completionMonitor().add(*state, std::move(callback));
+}
+
 WorkManager::~WorkManager()
 {
 	finish();
@@ -15,13 +126,75 @@ void WorkManager::add(std::unique_ptr<WorkBase> work)
 
 void WorkManager::submit()
 {
+	//submit all pending command works at once, with one submission per queue
+	std::vector<const CommandExecutionState*> states;
+	states.reserve(todo_.size());
+	for(auto& work : todo_)
+	{
+		if(work->submitted()) continue;
+
+		auto state = work->executionState();
+		if(state && state->valid()) states.push_back(state);
+	}
+
+	if(!states.empty()) states.front()->device().submitManager().submit(states);
+
+	//only updates the state of the already submitted works
 	for(auto& work : todo_) if(!work->submitted()) work->submit();
 }
 
 void WorkManager::finish()
 {
+	submit();
+
+	std::vector<WorkBase*> works;
+	works.reserve(todo_.size());
+	for(auto& work : todo_) works.push_back(work.get());
+
+	waitAll(works);
 	for(auto& work : todo_) if(!work->finished()) work->finish();
 	todo_.clear();
 }
 
+bool waitAll(const Range<WorkBase*>& works, std::uint64_t timeout)
+{
+	std::vector<const CommandExecutionState*> states;
+	for(auto& work : works)
+	{
+		//querying the state of a work may query its fence, so first check for execution state
+		auto state = work->executionState();
+		if(state) states.push_back(state);
+		else if(!work->executed()) work->wait();
+	}
+
+	return vpp::waitAll(states, timeout);
+}
+
+int waitAny(const Range<WorkBase*>& works, std::uint64_t timeout)
+{
+	std::vector<const CommandExecutionState*> states;
+	std::vector<unsigned int> ids;
+	for(auto i = 0u; i < works.size(); ++i)
+	{
+		if(works[i]->executed()) return i;
+
+		auto state = works[i]->executionState();
+		if(!state) continue;
+
+		states.push_back(state);
+		ids.push_back(i);
+	}
+
+	if(states.empty())
+	{
+		if(works.empty()) return -1;
+
+		works[0]->wait();
+		return 0;
+	}
+
+	auto id = vpp::waitAny(states, timeout);
+	return (id < 0) ? id : ids[id];
+}
+
 }